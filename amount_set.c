@@ -1,19 +1,63 @@
 #include "amount_set.h"
+#include "amount_set_ext.h"
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #define NO_SIZE -1
+#define DIRECTORY_MIN_SIZE 32 //smaller keyed sets are searched linearly
+
+//counts a node visited by a search when compiled with MATAMAZOM_STATS
+#ifdef MATAMAZOM_STATS
+#define COUNT_VISIT(set) \
+	((set)->visit_counter != NULL ? (void)(*(set)->visit_counter)++ : (void)0)
+#else
+#define COUNT_VISIT(set)
+#endif
 
 /** Type for defining the element node struct */
 typedef struct ASElementNode_t* ASElementNode;
 
-//defining element node
+//defining cursor, the set keeps its live cursors in a linked list
+struct ASCursor_t {
+	AmountSet set;//iterated set, NULL once the set is destroyed
+	ASElementNode node;//current node, NULL at the end
+	ASElementNode prev;//node before current, NULL at the start
+	ASCursor next_cursor;//next live cursor of the set
+	const MtmAllocator* allocator;//allocator of the cursor (outlives set)
+};
+
+//defining element node, the fields read by searches come first
 struct ASElementNode_t {
-	ASElement element;//element inside node
-	double amount;//amount of elements
+	unsigned int key;//key of element in keyed sets, 0 otherwise
 	ASElementNode next;//next node in linked list
+	double amount;//amount of elements
+	ASElement element;//element inside node
 };
 
+//defining key directory of keyed sets: the keys of the nodes, in list
+//order, packed many per cache line so searches binary search them instead
+//of walking the nodes
+typedef struct ASDirectory_t {
+	unsigned int* keys;//NULL while the set has no directory
+	ASElementNode* nodes;//node of each key
+	int capacity;
+} ASDirectory;
+
+//defining share count of copy on write sets, the sets that share nodes
+//point to the same share
+typedef struct ASShare_t {
+	int refcount;//number of sets sharing the nodes
+	ASDirectory directory;//directory of the shared nodes, the sets that
+	                      //share them use it as is
+} *ASShare;
+
+//defining a searched element with its key, read once per search
+typedef struct ASSearchKey_t {
+	ASElement element;
+	unsigned int key;//key of element in keyed sets
+} ASSearchKey;
+
 //defining amount set
 struct AmountSet_t {
 	int size;//size of lement linked list
@@ -22,38 +66,632 @@ struct AmountSet_t {
 	CopyASElement copyASElement;//copy function for ASElement
 	FreeASElement freeASElement;//free function for ASElement
 	CompareASElements cmpASElement;//compare function for ASElement
+	GetASElementKey getKey;//key function of keyed sets, NULL otherwise
+	const MtmAllocator* allocator;//allocator of the set and its nodes
+	ASCursor cursors;//live cursors, fixed by every link and remove
+	bool copy_on_write;//asCopy shares the nodes instead of copying them
+	ASShare share;//share of the nodes, NULL while the set owns them alone
+	ASDirectory directory;//built by the first search of a big keyed set
+	MtmMemoryCounter* memory;//counts nodes and directory, may be NULL
+	ASElementNode spares;//free nodes kept for reuse, linked by next
+	int num_spares;
+	int capacity;//size reserved by asReserve, 0 for none
+	bool read_only;//searches dont build or drop the directory
+#ifdef MATAMAZOM_STATS
+	unsigned long* visit_counter;//counts nodes visited by searches
+#endif
 };
 
 //defining static functions to use with ASElementNode
-static ASElementNode ASElementNodeCreate(CopyASElement copyElement,
-	                                     ASElementNode element);
+static ASElementNode ASElementNodeCreate(AmountSet set, ASElement element);
+static ASElementNode ASElementNodeCopy(AmountSet set, ASElementNode node);
 static ASElementNode getASElementNode(AmountSet set, ASElement element);       
+static void ASElementNodeChainDestroy(AmountSet set, ASElementNode chain);
+static void ASSparesRelease(AmountSet set, int keep);
+static void ASElementNodeLink(AmountSet set, ASElementNode prev_node,
+                              ASElementNode node);
+static void ASElementNodeRemove(AmountSet set, ASElementNode prev_node,
+                                ASElementNode node);
+static AmountSetResult ASElementNodeChainCreate(AmountSet target,
+                                                AmountSet source,
+                                                ASElementNode* chain);
+//for copy on write
+static AmountSetResult ASMakeExclusive(AmountSet set);
+static bool ASReleaseShare(AmountSet set);
+//for compares, by key in keyed sets
+static inline ASSearchKey ASSearchKeyOf(AmountSet set, ASElement element);
+static inline int ASCompareNode(AmountSet set, ASElementNode node,
+                                const ASSearchKey* search_key);
+static inline bool ASSameKeys(AmountSet set1, AmountSet set2);
+static inline int ASCompareNodes(AmountSet set, bool by_key,
+                                 ASElementNode node1, ASElementNode node2);
+//for the key directory
+static void ASDirectoryDrop(AmountSet set);
+static void ASDirectoryForget(AmountSet set);
+static bool ASDirectoryUse(AmountSet set);
+static int ASDirectoryLowerBound(AmountSet set, unsigned int key);
+static void ASDirectoryInsert(AmountSet set, ASElementNode prev_node,
+                              ASElementNode node);
+static void ASDirectoryRemove(AmountSet set, ASElementNode node);
+
+/*
+ASSearchKeyOf: returns the search key of an element
+INPUT:
+	@param set - the searched set
+	@param element - the searched element
+OUTPUT:
+	the element with its key (0 if the set isnt keyed)
+*/
+static inline ASSearchKey ASSearchKeyOf(AmountSet set, ASElement element) {
+	ASSearchKey search_key;
+	search_key.element = element;
+	search_key.key = (set->getKey != NULL) ? set->getKey(element) : 0;
+	return search_key;
+}
+
+/*
+ASCompareNode: compares the element of a node with a searched element, in
+keyed sets with an integer compare instead of the compare function
+INPUT:
+	@param set - the set of the node
+	@param node - the node
+	@param search_key - the searched element
+OUTPUT:
+	< 0 if the node element is smaller, > 0 if bigger, 0 if equal
+*/
+static inline int ASCompareNode(AmountSet set, ASElementNode node,
+                                const ASSearchKey* search_key) {
+	if (set->getKey != NULL) {
+		return (node->key > search_key->key) - (node->key < search_key->key);
+	}
+	return set->cmpASElement(node->element, search_key->element);
+}
+
+/*
+ASSameKeys: checks whether the nodes of two sets hold keys of the same
+key function, so they can be compared by key
+INPUT:
+	@param set1 - first set
+	@param set2 - second set
+*/
+static inline bool ASSameKeys(AmountSet set1, AmountSet set2) {
+	return set1->getKey != NULL && set1->getKey == set2->getKey;
+}
+
+/*
+ASCompareNodes: compares the elements of two nodes
+INPUT:
+	@param set - set whose compare function is used when not by key
+	@param by_key - true to compare the keys of the nodes
+	@param node1 - first node
+	@param node2 - second node
+OUTPUT:
+	< 0 if the first element is smaller, > 0 if bigger, 0 if equal
+*/
+static inline int ASCompareNodes(AmountSet set, bool by_key,
+                                 ASElementNode node1, ASElementNode node2) {
+	if (by_key) {
+		return (node1->key > node2->key) - (node1->key < node2->key);
+	}
+	return set->cmpASElement(node1->element, node2->element);
+}
+
+/*
+ASDirectoryDrop: frees the key directory of the set, the next search
+builds it again. used before changes of many nodes. the directory of
+shared nodes belongs to their share, the set only forgets it
+INPUT:
+	@param set - the set
+*/
+static void ASDirectoryDrop(AmountSet set) {
+	if (set->share == NULL) {
+		mtmMemorySub(set->memory, 0, set->directory.capacity *
+		             (sizeof(unsigned int) + sizeof(ASElementNode)));
+		mtmRelease(set->allocator, set->directory.keys);
+		mtmRelease(set->allocator, set->directory.nodes);
+	}
+	ASDirectoryForget(set);
+}
+
+/*
+ASDirectoryForget: clears the key directory of the set without freeing it
+INPUT:
+	@param set - the set
+*/
+static void ASDirectoryForget(AmountSet set) {
+	set->directory.keys = NULL;
+	set->directory.nodes = NULL;
+	set->directory.capacity = 0;
+}
+
+/*
+ASDirectoryUse: checks whether searches of the set can use the directory,
+building it if the set is keyed and big enough
+INPUT:
+	@param set - the set
+OUTPUT:
+	true if the directory is valid, false to search the list
+*/
+static bool ASDirectoryUse(AmountSet set) {
+
+	if (set->directory.keys != NULL) {
+		return true;
+	}
+	if (set->share != NULL && set->share->directory.keys != NULL) {
+		set->directory = set->share->directory;//built by another copy
+		return true;
+	}
+	if (set->read_only || set->getKey == NULL ||
+	    set->size < DIRECTORY_MIN_SIZE) {
+		return false;
+	}
+
+	//builds it in one walk of the list, room to grow is left
+	int capacity = 2 * set->size;
+	if (capacity < set->capacity) {//room for the reserved size
+		capacity = set->capacity;
+	}
+	set->directory.keys = mtmAllocate(set->allocator,
+	                                  capacity * sizeof(unsigned int));
+	set->directory.nodes = mtmAllocate(set->allocator,
+	                                   capacity * sizeof(ASElementNode));
+	if (set->directory.keys == NULL || set->directory.nodes == NULL) {
+		ASDirectoryDrop(set);
+		return false;//searches walk the list
+	}
+	set->directory.capacity = capacity;
+	mtmMemoryAdd(set->memory, 0, capacity *
+	             (sizeof(unsigned int) + sizeof(ASElementNode)));
+	int position = 0;
+	for (ASElementNode node_ptr = set->head; node_ptr != NULL;
+	     node_ptr = node_ptr->next, position++) {
+		set->directory.keys[position] = node_ptr->key;
+		set->directory.nodes[position] = node_ptr;
+	}
+	if (set->share != NULL) {//the copies sharing the nodes use it too
+		set->share->directory = set->directory;
+	}
+	return true;
+}
+
+/*
+ASDirectoryLowerBound: binary searches the directory for a key
+INPUT:
+	@param set - set with a valid directory
+	@param key - the key
+OUTPUT:
+	position of the first key that isnt smaller than key, size of the set
+	if there is none
+*/
+static int ASDirectoryLowerBound(AmountSet set, unsigned int key) {
+
+	int low = 0, high = set->size;
+	while (low < high) {
+		COUNT_VISIT(set);
+		int middle = low + (high - low) / 2;
+		if (set->directory.keys[middle] < key) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/*
+ASDirectoryInsert: adds a node that is being linked to the directory, if
+the set has one. called before the set size grows
+INPUT:
+	@param set - the set
+	@param prev_node - the node before it, NULL if it becomes the head
+	@param node - the linked node
+*/
+static void ASDirectoryInsert(AmountSet set, ASElementNode prev_node,
+                              ASElementNode node) {
+
+	ASDirectory* directory = &set->directory;
+	if (directory->keys == NULL) {
+		return;
+	}
+	if (set->size == directory->capacity) {//grows it, or drops it
+		int capacity = 2 * directory->capacity;
+		unsigned int* keys = mtmAllocate(set->allocator,
+		                                 capacity * sizeof(*keys));
+		ASElementNode* nodes = mtmAllocate(set->allocator,
+		                                   capacity * sizeof(*nodes));
+		if (keys == NULL || nodes == NULL) {
+			mtmRelease(set->allocator, keys);
+			mtmRelease(set->allocator, nodes);
+			ASDirectoryDrop(set);
+			return;
+		}
+		memcpy(keys, directory->keys, set->size * sizeof(*keys));
+		memcpy(nodes, directory->nodes, set->size * sizeof(*nodes));
+		ASDirectoryDrop(set);
+		directory->keys = keys;
+		directory->nodes = nodes;
+		directory->capacity = capacity;
+		mtmMemoryAdd(set->memory, 0, capacity * (sizeof(*keys) +
+		                                         sizeof(*nodes)));
+	}
+
+	int position = (prev_node == NULL) ? 0 :
+	               ASDirectoryLowerBound(set, prev_node->key) + 1;
+	memmove(&directory->keys[position + 1], &directory->keys[position],
+	        (set->size - position) * sizeof(*directory->keys));
+	memmove(&directory->nodes[position + 1], &directory->nodes[position],
+	        (set->size - position) * sizeof(*directory->nodes));
+	directory->keys[position] = node->key;
+	directory->nodes[position] = node;
+}
+
+/*
+ASDirectoryRemove: removes a node that is being unlinked from the
+directory, if the set has one. called before the set size drops
+INPUT:
+	@param set - the set
+	@param node - the unlinked node
+*/
+static void ASDirectoryRemove(AmountSet set, ASElementNode node) {
+
+	ASDirectory* directory = &set->directory;
+	if (directory->keys == NULL) {
+		return;
+	}
+	int position = ASDirectoryLowerBound(set, node->key);
+	assert(position < set->size && directory->nodes[position] == node);
+	memmove(&directory->keys[position], &directory->keys[position + 1],
+	        (set->size - position - 1) * sizeof(*directory->keys));
+	memmove(&directory->nodes[position], &directory->nodes[position + 1],
+	        (set->size - position - 1) * sizeof(*directory->nodes));
+}
 
 /*
 ASElementNodeCreate: create function for struct ASElementNode
 INPUT:
-	@param copyElement - function to copy the given element 
+	@param set - the set the node is created for (its allocator and copy
+	             function are used)
 	@param element - the element value in the created node
 OUTPUT:
 	@param allocated_node - created node with its new values
 */
-static ASElementNode ASElementNodeCreate(CopyASElement copyElement,
-	                                     ASElementNode element) {
+static ASElementNode ASElementNodeCreate(AmountSet set, ASElement element) {
 
-	//allocating node and checking if allocation is valid
-	ASElementNode allocated_node = malloc(sizeof(*allocated_node));
-	if (allocated_node == NULL) {
-		return NULL;
+	//takes a spare node if there is one, its bytes are counted already
+	ASElementNode allocated_node = set->spares;
+	if (allocated_node != NULL) {
+		set->spares = allocated_node->next;
+		set->num_spares--;
+		mtmMemoryAdd(set->memory, 1, 0);
+	}
+	else {//allocating node and checking if allocation is valid
+		allocated_node = mtmAllocate(set->allocator, sizeof(*allocated_node));
+		if (allocated_node == NULL) {
+			return NULL;
+		}
+		mtmMemoryAdd(set->memory, 1, sizeof(*allocated_node));
 	}
 
 	//setting values
 	allocated_node->amount = 0.0;
-	allocated_node->element = copyElement(element);
+	allocated_node->element = set->copyASElement(element);
 	allocated_node->next = NULL;
+	allocated_node->key = (set->getKey != NULL && allocated_node->element !=
+	                       NULL) ? set->getKey(allocated_node->element) : 0;
 	
 	return allocated_node;
 }
 
+/*
+ASElementNodeCopy: creates a copy of a node of the set, with its amount
+and its key (the copy of an element has the key of the element)
+INPUT:
+	@param set - the set of the node
+	@param node - the copied node
+OUTPUT:
+	the copy, unlinked, or NULL if allocation or the element copy failed
+*/
+static ASElementNode ASElementNodeCopy(AmountSet set, ASElementNode node) {
+
+	ASElementNode allocated_node = set->spares;
+	if (allocated_node != NULL) {
+		set->spares = allocated_node->next;
+		set->num_spares--;
+		mtmMemoryAdd(set->memory, 1, 0);
+	}
+	else {
+		allocated_node = mtmAllocate(set->allocator, sizeof(*allocated_node));
+		if (allocated_node == NULL) {
+			return NULL;
+		}
+		mtmMemoryAdd(set->memory, 1, sizeof(*allocated_node));
+	}
+	allocated_node->element = set->copyASElement(node->element);
+	if (allocated_node->element == NULL) {
+		mtmRelease(set->allocator, allocated_node);
+		mtmMemorySub(set->memory, 1, sizeof(*allocated_node));
+		return NULL;
+	}
+	allocated_node->key = node->key;
+	allocated_node->amount = node->amount;
+	allocated_node->next = NULL;
+	return allocated_node;
+}
+
+/*
+ASElementNodeChainDestroy: frees a chain of nodes that isnt linked to the set
+INPUT:
+	@param set - the set the nodes were created for
+	@param chain - first node of the chain, may be NULL
+*/
+static void ASElementNodeChainDestroy(AmountSet set, ASElementNode chain) {
+
+	while (chain != NULL) {
+		ASElementNode next_node = chain->next;
+		if (chain->element != NULL) {
+			set->freeASElement(chain->element);
+		}
+		mtmRelease(set->allocator, chain);
+		mtmMemorySub(set->memory, 1, sizeof(*chain));
+		chain = next_node;
+	}
+}
+
+/*
+ASSparesRelease: frees spare nodes of the set
+INPUT:
+	@param set - the set
+	@param keep - number of spare nodes to keep
+*/
+static void ASSparesRelease(AmountSet set, int keep) {
+
+	while (set->num_spares > keep) {
+		ASElementNode spare = set->spares;
+		set->spares = spare->next;
+		set->num_spares--;
+		mtmRelease(set->allocator, spare);
+		mtmMemorySub(set->memory, 0, sizeof(*spare));
+	}
+}
+
+/*
+ASElementNodeLink: links a node into the set after prev_node
+INPUT:
+	@param set - the set
+	@param prev_node - the node before it, NULL to link it as the head
+	@param node - node to link
+NOTE: cursors placed right after prev_node skip the new node
+*/
+static void ASElementNodeLink(AmountSet set, ASElementNode prev_node,
+                              ASElementNode node) {
+
+	assert(set->share == NULL);//shared nodes are never changed
+	ASDirectoryInsert(set, prev_node, node);
+	ASElementNode next_node = (prev_node == NULL) ? set->head :
+	                                                prev_node->next;
+	node->next = next_node;
+	if (prev_node == NULL) {
+		set->head = node;
+	}
+	else {
+		prev_node->next = node;
+	}
+	set->size++;
+
+	//cursors between prev_node and next_node now follow the new node
+	for (ASCursor cursor = set->cursors; cursor != NULL;
+	     cursor = cursor->next_cursor) {
+		if (cursor->prev == prev_node && cursor->node == next_node) {
+			cursor->prev = node;
+		}
+	}
+}
+
+/*
+ASElementNodeRemove: unlinks a node from the set and frees it
+INPUT:
+	@param set - the set that contains the node
+	@param prev_node - the node before it, NULL if node is the head
+	@param node - node to remove
+NOTE: cursors on the node move to the next one
+*/
+static void ASElementNodeRemove(AmountSet set, ASElementNode prev_node,
+                                ASElementNode node) {
+
+	assert(set->share == NULL);//shared nodes are never changed
+	ASDirectoryRemove(set, node);
+	for (ASCursor cursor = set->cursors; cursor != NULL;
+	     cursor = cursor->next_cursor) {
+		if (cursor->node == node) {
+			cursor->node = node->next;
+		}
+		if (cursor->prev == node) {
+			cursor->prev = prev_node;
+		}
+	}
+
+	if (prev_node == NULL) {
+		set->head = node->next;
+	}
+	else {
+		prev_node->next = node->next;
+	}
+	set->freeASElement(node->element);
+	assert(set->size > 0);
+	set->size--;
+
+	//keeps the node while the set is below its reserved size
+	if (set->size + set->num_spares < set->capacity) {
+		node->next = set->spares;
+		set->spares = node;
+		set->num_spares++;
+		mtmMemorySub(set->memory, 1, 0);
+	}
+	else {
+		mtmRelease(set->allocator, node);
+		mtmMemorySub(set->memory, 1, sizeof(*node));
+	}
+}
+
+/*
+ASElementNodeChainCreate: creates, in order, the nodes of the source
+elements that are missing in target, chained by their next field
+INPUT:
+	@param target - the set the nodes are created for
+	@param source - set with the same order as target
+	@param chain - where the chain is returned, NULL if nothing is missing
+OUTPUT:
+	AS_OUT_OF_MEMORY if allocation failed (nothing is returned), else
+	AS_SUCCESS
+*/
+static AmountSetResult ASElementNodeChainCreate(AmountSet target,
+                                                AmountSet source,
+                                                ASElementNode* chain) {
+
+	*chain = NULL;
+	ASElementNode* chain_tail = chain;
+	bool by_key = ASSameKeys(target, source);
+	ASElementNode target_ptr = target->head;
+	for (ASElementNode source_ptr = source->head; source_ptr != NULL;
+	     source_ptr = source_ptr->next) {
+		while (target_ptr != NULL &&
+		       ASCompareNodes(target, by_key, target_ptr, source_ptr) < 0) {
+			target_ptr = target_ptr->next;//forwarding
+		}
+		if (target_ptr != NULL &&
+		    ASCompareNodes(target, by_key, target_ptr, source_ptr) == 0) {
+			continue;
+		}
+		*chain_tail = ASElementNodeCreate(target, source_ptr->element);
+		if (*chain_tail == NULL || (*chain_tail)->element == NULL) {
+			ASElementNodeChainDestroy(target, *chain);
+			*chain = NULL;
+			return AS_OUT_OF_MEMORY;
+		}
+		chain_tail = &(*chain_tail)->next;
+	}
+	return AS_SUCCESS;
+}
+
+/*
+ASMakeExclusive: makes sure the set owns its nodes before it's changed.
+if the nodes are shared with copies, the set gets its own copy of them
+(elements are copied with the copy function, which may share them) and of
+their directory, and its cursors and iterator move to the new nodes
+INPUT:
+	@param set - the set about to be changed
+OUTPUT:
+	AS_OUT_OF_MEMORY if copying failed (the set still shares its nodes),
+	else AS_SUCCESS
+*/
+static AmountSetResult ASMakeExclusive(AmountSet set) {
+
+	if (set->share == NULL) {
+		return AS_SUCCESS;
+	}
+	if (set->share->refcount == 1) {//other copies are gone
+		set->directory = set->share->directory;
+		mtmRelease(set->allocator, set->share);
+		set->share = NULL;
+		return AS_SUCCESS;
+	}
+
+	//the new directory is filled while copying, if there is room for it
+	ASDirectory directory = { NULL, NULL, 0 };
+	if (set->share->directory.keys != NULL) {
+		directory.capacity = set->share->directory.capacity;
+		directory.keys = mtmAllocate(set->allocator, directory.capacity *
+		                             sizeof(*directory.keys));
+		directory.nodes = mtmAllocate(set->allocator, directory.capacity *
+		                              sizeof(*directory.nodes));
+		if (directory.keys == NULL || directory.nodes == NULL) {
+			mtmRelease(set->allocator, directory.keys);
+			mtmRelease(set->allocator, directory.nodes);
+			directory.keys = NULL;
+			directory.nodes = NULL;
+			directory.capacity = 0;//the next search builds it
+		}
+	}
+
+	//copies the nodes in order in one walk, the keys are the old ones
+	ASElementNode new_head = NULL;
+	ASElementNode* new_tail = &new_head;
+	ASElementNode new_iterator = NULL;
+	int position = 0;
+	for (ASElementNode node_ptr = set->head; node_ptr != NULL;
+	     node_ptr = node_ptr->next, position++) {
+		ASElementNode new_node = ASElementNodeCopy(set, node_ptr);
+		if (new_node == NULL) {
+			ASElementNodeChainDestroy(set, new_head);
+			mtmRelease(set->allocator, directory.keys);
+			mtmRelease(set->allocator, directory.nodes);
+			return AS_OUT_OF_MEMORY;
+		}
+		if (directory.keys != NULL) {
+			directory.keys[position] = new_node->key;
+			directory.nodes[position] = new_node;
+		}
+		if (set->iterator == node_ptr) {
+			new_iterator = new_node;
+		}
+		*new_tail = new_node;
+		new_tail = &new_node->next;
+	}
+	mtmMemoryAdd(set->memory, 0, directory.capacity *
+	             (sizeof(*directory.keys) + sizeof(*directory.nodes)));
+
+	//cursors are rare, a second walk moves them to the new nodes
+	if (set->cursors != NULL) {
+		ASElementNode new_node = new_head;
+		for (ASElementNode node_ptr = set->head; node_ptr != NULL;
+		     node_ptr = node_ptr->next, new_node = new_node->next) {
+			for (ASCursor cursor = set->cursors; cursor != NULL;
+			     cursor = cursor->next_cursor) {
+				if (cursor->node == node_ptr) {
+					cursor->node = new_node;
+				}
+				if (cursor->prev == node_ptr) {
+					cursor->prev = new_node;
+				}
+			}
+		}
+	}
+
+	set->iterator = new_iterator;
+	set->head = new_head;
+	set->directory = directory;
+	set->share->refcount--;
+	set->share = NULL;
+	return AS_SUCCESS;
+}
+
+/*
+ASReleaseShare: drops the set's reference to shared nodes
+INPUT:
+	@param set - the set
+OUTPUT:
+	true if other sets still share the nodes (the set must forget them
+	without freeing, it has forgotten their directory), false if the set
+	owns them and their directory
+*/
+static bool ASReleaseShare(AmountSet set) {
+
+	if (set->share == NULL) {
+		return false;
+	}
+	if (set->share->refcount == 1) {
+		set->directory = set->share->directory;
+		mtmRelease(set->allocator, set->share);
+		set->share = NULL;
+		return false;
+	}
+	set->share->refcount--;
+	set->share = NULL;
+	ASDirectoryForget(set);
+	return true;
+}
+
 /*
 getASElementNode: returns the requested element node from a given node
 INPUT:
@@ -68,13 +706,27 @@ static ASElementNode getASElementNode(AmountSet set, ASElement element) {
 
 	assert(set != NULL && element != NULL);//asserting the ptrs arent null
 	
-	//while loop that searches for the element on the linked list
+	//big keyed sets binary search their directory
+	ASSearchKey search_key = ASSearchKeyOf(set, element);
+	if (ASDirectoryUse(set)) {
+		int position = ASDirectoryLowerBound(set, search_key.key);
+		return (position < set->size &&
+		        set->directory.keys[position] == search_key.key) ?
+		       set->directory.nodes[position] : NULL;
+	}
+
+	//while loop that searches for the element on the sorted linked list
 	ASElementNode node_ptr = set->head;
 	while (node_ptr != NULL) {
 
-		if (set->cmpASElement(node_ptr->element, element) == 0) { //match
+		COUNT_VISIT(set);
+		int compare_result = ASCompareNode(set, node_ptr, &search_key);
+		if (compare_result == 0) { //match
 			return node_ptr;
 		}
+		if (compare_result > 0) {//passed its place, not in set
+			return NULL;
+		}
 
 		node_ptr = node_ptr->next;//forwarding
 	}
@@ -87,32 +739,84 @@ static ASElementNode getASElementNode(AmountSet set, ASElement element) {
 AmountSet asCreate(CopyASElement copyElement,FreeASElement freeElement,
 	               CompareASElements compareElements) {
 
-	if (copyElement == NULL || freeElement == NULL || compareElements == NULL){
+	return asCreateWithAllocator(copyElement, freeElement, compareElements,
+	                             mtmDefaultAllocator());
+}
+
+AmountSet asCreateWithAllocator(CopyASElement copyElement,
+	                            FreeASElement freeElement,
+	                            CompareASElements compareElements,
+	                            const MtmAllocator* allocator) {
+
+	if (copyElement == NULL || freeElement == NULL || compareElements == NULL
+		|| allocator == NULL){
 		return NULL;
 	}
 
 	//allocating new amount set
-	AmountSet allocated_as = malloc(sizeof(*allocated_as));
+	AmountSet allocated_as = mtmAllocate(allocator, sizeof(*allocated_as));
 	if (allocated_as == NULL) {
 		return NULL;
 	}
 
 	//setting variables
+	allocated_as->allocator = allocator;
 	allocated_as->cmpASElement = compareElements;
+	allocated_as->getKey = NULL;
 	allocated_as->copyASElement = copyElement;
 	allocated_as->freeASElement = freeElement;
 	allocated_as->head = NULL;
 	allocated_as->iterator = NULL;
+	allocated_as->cursors = NULL;
+	allocated_as->copy_on_write = false;
+	allocated_as->share = NULL;
+	allocated_as->directory.keys = NULL;
+	allocated_as->directory.nodes = NULL;
+	allocated_as->directory.capacity = 0;
+	allocated_as->memory = NULL;
+	allocated_as->spares = NULL;
+	allocated_as->num_spares = 0;
+	allocated_as->capacity = 0;
+	allocated_as->read_only = false;
 	allocated_as->size = 0;
+#ifdef MATAMAZOM_STATS
+	allocated_as->visit_counter = NULL;
+#endif
 
 	return allocated_as;
 }
 
+AmountSet asCreateKeyed(CopyASElement copyElement,
+                        FreeASElement freeElement,
+                        CompareASElements compareElements,
+                        GetASElementKey getKey,
+                        const MtmAllocator* allocator) {
+
+	if (getKey == NULL) {
+		return NULL;
+	}
+	AmountSet allocated_as = asCreateWithAllocator(copyElement, freeElement,
+	                                               compareElements, allocator);
+	if (allocated_as != NULL) {
+		allocated_as->getKey = getKey;
+	}
+	return allocated_as;
+}
+
 void asDestroy(AmountSet set){
 
-	//clears set and frees it, no need to check NULL
+	if (set == NULL) {
+		return;
+	}
+
+	//clears set and frees it
 	asClear(set);
-	free(set);
+	ASSparesRelease(set, 0);
+	for (ASCursor cursor = set->cursors; cursor != NULL;
+	     cursor = cursor->next_cursor) {
+		cursor->set = NULL;//detaches live cursors
+	}
+	mtmRelease(set->allocator, set);
 }
 
 AmountSet asCopy(AmountSet set) {
@@ -122,28 +826,44 @@ AmountSet asCopy(AmountSet set) {
 	}
 
 	//creates new target set for copy and checks allocaiton
-	AmountSet target_set = asCreate(set->copyASElement, set->freeASElement,
-														set->cmpASElement);
+	AmountSet target_set = asCreateWithAllocator(set->copyASElement,
+	                                             set->freeASElement,
+	                                             set->cmpASElement,
+	                                             set->allocator);
 	if (target_set == NULL) {
 		return NULL;
 	}
-	
-	//while loop that copies the elements from set to target_set
-	double target_amount = 0;
-	ASElementNode elem_ptr = set->head;
-	while (elem_ptr != NULL){
-		
-		//register elements and amount to to target_set and checking if valid
-		if (asRegister(target_set, elem_ptr->element) != AS_SUCCESS ||
-		    asGetAmount(set, elem_ptr->element, &target_amount) != AS_SUCCESS
-			|| asChangeAmount(target_set, elem_ptr->element, target_amount)
-			!= AS_SUCCESS) {
+	target_set->getKey = set->getKey;
+	target_set->memory = set->memory;
+#ifdef MATAMAZOM_STATS
+	target_set->visit_counter = set->visit_counter;
+#endif
 
-			asDestroy(target_set);//if failed, destroys set and exit with null
-			return NULL;
+	//copy on write - target_set shares the nodes until one of them changes
+	if (set->copy_on_write) {
+		if (set->share == NULL) {
+			set->share = mtmAllocate(set->allocator, sizeof(*set->share));
+			if (set->share == NULL) {
+				asDestroy(target_set);
+				return NULL;
+			}
+			set->share->refcount = 1;
+			set->share->directory = set->directory;//now of the share
 		}
+		set->share->refcount++;
+		target_set->share = set->share;
+		target_set->copy_on_write = true;
+		target_set->head = set->head;
+		target_set->size = set->size;
+		target_set->directory = set->share->directory;
+		set->iterator = NULL; //resets iterator
+		return target_set;
+	}
 	
-		elem_ptr = elem_ptr->next;//forwarding
+	//merging into the empty target_set copies the elements in one walk
+	if (asMerge(target_set, set) != AS_SUCCESS) {
+		asDestroy(target_set);//if failed, destroys set and exit with null
+		return NULL;
 	}
 
 	//resets iterators
@@ -191,14 +911,24 @@ AmountSetResult asRegister(AmountSet set, ASElement element) {
 	if (asContains(set, element)){
 		return AS_ITEM_ALREADY_EXISTS;
 	}
+	if (ASMakeExclusive(set) != AS_SUCCESS) {
+		return AS_OUT_OF_MEMORY;
+	}
 	//allocation of new _node with given element and memory check
-	ASElementNode new_node = ASElementNodeCreate(set->copyASElement, element);
+	ASElementNode new_node = ASElementNodeCreate(set, element);
 	if (new_node == NULL){
 		return AS_OUT_OF_MEMORY;
 	}
 	bool flag = false;//exit flag from while, true when new node registered
-	if (set->size == 0) {//register when linked list is mpty
-		set->head = new_node;
+	bool by_key = (set->getKey != NULL);
+	if (ASDirectoryUse(set)) {//links it after the last smaller key
+		int position = ASDirectoryLowerBound(set, new_node->key);
+		ASElementNodeLink(set, (position == 0) ? NULL :
+		                       set->directory.nodes[position - 1], new_node);
+		flag = true;
+	}
+	else if (set->size == 0) {//register when linked list is mpty
+		ASElementNodeLink(set, NULL, new_node);
 		flag = true;
 	}
 	else { //register when linked list isnt empty
@@ -206,31 +936,27 @@ AmountSetResult asRegister(AmountSet set, ASElement element) {
 		while (cur_node != NULL && flag == false) {
 			//if new node is smaller than first node
 			if (cur_node == set->head && 
-				set->cmpASElement(cur_node->element, new_node->element) >= 0) {
-				set->head = new_node;
-				new_node->next = cur_node;
+				ASCompareNodes(set, by_key, cur_node, new_node) >= 0) {
+				ASElementNodeLink(set, NULL, new_node);
 				flag = true;
 			}
 			//if new node is bigger than next node
 			else if (cur_node->next == NULL && 
-				     set->cmpASElement(cur_node->element,
-						               new_node->element) <= 0) {
-				cur_node->next = new_node;
+				     ASCompareNodes(set, by_key, cur_node, new_node) <= 0) {
+				ASElementNodeLink(set, cur_node, new_node);
 				flag = true;
 			}
 			else if (cur_node->next != NULL && 
-				     set->cmpASElement(cur_node->element,new_node->element) <= 0
-				     &&set->cmpASElement(cur_node->next->element,
-						               new_node->element) >= 0) {
-				new_node->next = cur_node->next;
-				cur_node->next = new_node;
+				     ASCompareNodes(set, by_key, cur_node, new_node) <= 0
+				     && ASCompareNodes(set, by_key, cur_node->next,
+				                       new_node) >= 0) {
+				ASElementNodeLink(set, cur_node, new_node);
 				flag = true;
 			}
 			cur_node = cur_node->next;//forwarding
 		}
 	}
 	assert(flag == true);
-	set->size++;
 	set->iterator = NULL; //reset iterator
 	return AS_SUCCESS;
 }
@@ -251,6 +977,9 @@ AmountSetResult asChangeAmount(AmountSet set, ASElement element,
 	{
 		return AS_INSUFFICIENT_AMOUNT;//if not return error
 	}
+	if (ASMakeExclusive(set) != AS_SUCCESS) {
+		return AS_OUT_OF_MEMORY;
+	}
 
 	//else we increase the node amount and return success
 	getASElementNode(set, element)->amount += amount;
@@ -262,32 +991,37 @@ AmountSetResult asDelete(AmountSet set, ASElement element) {
 	if (set == NULL || element == NULL) {
 		return AS_NULL_ARGUMENT;
 	}
+	if (set->share != NULL && !asContains(set, element)) {
+		return AS_ITEM_DOES_NOT_EXIST;//nothing to change, keeps sharing
+	}
+	if (ASMakeExclusive(set) != AS_SUCCESS) {
+		return AS_OUT_OF_MEMORY;
+	}
+
+	//big keyed sets find the node and the one before it in the directory
+	ASSearchKey search_key = ASSearchKeyOf(set, element);
+	if (ASDirectoryUse(set)) {
+		int position = ASDirectoryLowerBound(set, search_key.key);
+		if (position == set->size ||
+		    set->directory.keys[position] != search_key.key) {
+			return AS_ITEM_DOES_NOT_EXIST;
+		}
+		ASElementNodeRemove(set, (position == 0) ? NULL :
+		                         set->directory.nodes[position - 1],
+		                    set->directory.nodes[position]);
+		set->iterator = NULL; //reset iterator
+		return AS_SUCCESS;
+	}
 
 	//while loop that finds the element node and deletes it
 	ASElementNode node_ptr = set->head;
 	ASElementNode prev_node_ptr = NULL;
 	while (node_ptr != NULL) {
 		
-		if (set->cmpASElement(node_ptr->element, element) == 0) {//match
-			
-			//free element
-			set->freeASElement(node_ptr->element);
-
-			//sets head and prev node in list accordingly(compensate)
-			if (node_ptr == set->head){
-				set->head = node_ptr->next;
-			}
-			else
-			{
-				prev_node_ptr->next = node_ptr->next;
-			}
+		if (ASCompareNode(set, node_ptr, &search_key) == 0) {//match
 			
-			//frees the node 
-			free(node_ptr);
-			
-			//asserting that the list size atm has to be positive
-			assert(set->size > 0);
-			set->size--;
+			//unlinks the node (compensates prev node) and frees it
+			ASElementNodeRemove(set, prev_node_ptr, node_ptr);
 			set->iterator = NULL; //reset iterator
 			return AS_SUCCESS;
 		}
@@ -307,22 +1041,34 @@ AmountSetResult asClear(AmountSet set) {
 		return AS_NULL_ARGUMENT;
 	}
 
+	//shared nodes belong to the other copies too, the set just drops them
+	if (ASReleaseShare(set)) {
+		set->head = NULL;
+		set->size = 0;
+		set->iterator = NULL;
+		for (ASCursor cursor = set->cursors; cursor != NULL;
+		     cursor = cursor->next_cursor) {
+			cursor->node = NULL;
+			cursor->prev = NULL;
+		}
+		return AS_SUCCESS;
+	}
+
+	ASDirectoryDrop(set);//deleting the head doesnt need it
+
 	//while loop that delets the link list
-	AmountSetResult ret_value;
 	ASElementNode head_ptr = set->head;
 	while (head_ptr != NULL){
 		
-		//deletes the head and checks if valid
-		ret_value = asDelete(set, head_ptr->element);
-		if (ret_value == AS_NULL_ARGUMENT) {
-			return ret_value;//returns specific function result
-		}
+		//unlinks the head and frees it, without searching for it
+		ASElementNodeRemove(set, NULL, head_ptr);
 
 		//**set->head is set now to the previous set->head->next value
 		head_ptr = set->head;//therefore thats the forwarding
 	}
+	set->iterator = NULL; //reset iterator
 	
-	//size, iterator, head values of set were effected, no need to reset them 
+	//size and head values of set were effected, no need to reset them 
 
 	return AS_SUCCESS;
 }
@@ -345,7 +1091,441 @@ ASElement asGetNext(AmountSet set) {
 	}
 	
 	//setting iterator to be the next node and returns its element
-	set->iterator = getASElementNode(set, set->iterator->element)->next;
+	set->iterator = set->iterator->next;
     return (set->iterator == NULL) ? NULL : set->iterator->element;
 }
 
+
+//amount set extensions with comments on amount_set_ext.h
+
+AmountSetResult asApplyUpdates(AmountSet set, const ASUpdate* updates,
+                               int count) {
+
+	if (set == NULL || (updates == NULL && count > 0)) {
+		return AS_NULL_ARGUMENT;
+	}
+	if (count > 0 && ASMakeExclusive(set) != AS_SUCCESS) {
+		return AS_OUT_OF_MEMORY;
+	}
+	if (count > 0) {
+		ASDirectoryDrop(set);//the walk is linear anyway, rebuilt on search
+	}
+
+	//first walk - allocates the nodes of the missing elements up front,
+	//chained in update order, so the set isnt touched if memory runs out
+	ASElementNode new_nodes = NULL;
+	ASElementNode* new_nodes_tail = &new_nodes;
+	ASElementNode node_ptr = set->head;
+	for (int i = 0; i < count; i++) {
+		assert(updates[i].element != NULL);
+		assert(i == 0 ||
+		       set->cmpASElement(updates[i - 1].element, updates[i].element) < 0);
+		ASSearchKey search_key = ASSearchKeyOf(set, updates[i].element);
+		while (node_ptr != NULL &&
+		       ASCompareNode(set, node_ptr, &search_key) < 0) {
+			node_ptr = node_ptr->next;//forwarding
+		}
+		bool exists = node_ptr != NULL &&
+		              ASCompareNode(set, node_ptr, &search_key) == 0;
+		if (exists || updates[i].remove) {
+			continue;
+		}
+		*new_nodes_tail = ASElementNodeCreate(set, updates[i].element);
+		if (*new_nodes_tail == NULL || (*new_nodes_tail)->element == NULL) {
+			ASElementNodeChainDestroy(set, new_nodes);
+			return AS_OUT_OF_MEMORY;
+		}
+		new_nodes_tail = &(*new_nodes_tail)->next;
+	}
+
+	//second walk - applies the updates, can no longer fail
+	ASElementNode prev_node_ptr = NULL;
+	node_ptr = set->head;
+	for (int i = 0; i < count; i++) {
+		ASSearchKey search_key = ASSearchKeyOf(set, updates[i].element);
+		while (node_ptr != NULL &&
+		       ASCompareNode(set, node_ptr, &search_key) < 0) {
+			prev_node_ptr = node_ptr;
+			node_ptr = node_ptr->next;//forwarding
+		}
+		if (node_ptr != NULL &&
+		    ASCompareNode(set, node_ptr, &search_key) == 0) {
+			if (!updates[i].remove) {//existing element - sets amount
+				node_ptr->amount = updates[i].amount;
+				continue;
+			}
+			//removes the node, prev node stays the same
+			ASElementNode next_node = node_ptr->next;
+			ASElementNodeRemove(set, prev_node_ptr, node_ptr);
+			node_ptr = next_node;
+		}
+		else if (!updates[i].remove) {//missing element - links new node
+			ASElementNode new_node = new_nodes;
+			new_nodes = new_nodes->next;
+			new_node->amount = updates[i].amount;
+			ASElementNodeLink(set, prev_node_ptr, new_node);
+			prev_node_ptr = new_node;
+		}
+	}
+	assert(new_nodes == NULL);
+
+	set->iterator = NULL; //reset iterator
+	return AS_SUCCESS;
+}
+
+AmountSetResult asMerge(AmountSet target, AmountSet source) {
+
+	if (target == NULL || source == NULL) {
+		return AS_NULL_ARGUMENT;
+	}
+	if (source->head != NULL && ASMakeExclusive(target) != AS_SUCCESS) {
+		return AS_OUT_OF_MEMORY;
+	}
+	if (source->head != NULL) {
+		ASDirectoryDrop(target);//the walk is linear anyway
+	}
+
+	//allocates the missing nodes before the target is changed
+	ASElementNode new_nodes = NULL;
+	if (ASElementNodeChainCreate(target, source, &new_nodes) != AS_SUCCESS) {
+		return AS_OUT_OF_MEMORY;
+	}
+
+	//walks both sets in parallel, adds amounts and links the new nodes
+	bool by_key = ASSameKeys(target, source);
+	ASElementNode prev_node_ptr = NULL;
+	ASElementNode target_ptr = target->head;
+	for (ASElementNode source_ptr = source->head; source_ptr != NULL;
+	     source_ptr = source_ptr->next) {
+		while (target_ptr != NULL &&
+		       ASCompareNodes(target, by_key, target_ptr, source_ptr) < 0) {
+			prev_node_ptr = target_ptr;
+			target_ptr = target_ptr->next;//forwarding
+		}
+		if (target_ptr != NULL &&
+		    ASCompareNodes(target, by_key, target_ptr, source_ptr) == 0) {
+			target_ptr->amount += source_ptr->amount;
+			continue;
+		}
+		ASElementNode new_node = new_nodes;
+		new_nodes = new_nodes->next;
+		new_node->amount = source_ptr->amount;
+		ASElementNodeLink(target, prev_node_ptr, new_node);
+		prev_node_ptr = new_node;
+	}
+	assert(new_nodes == NULL);
+
+	target->iterator = NULL; //reset iterators
+	source->iterator = NULL;
+	return AS_SUCCESS;
+}
+
+AmountSetResult asSubtract(AmountSet target, AmountSet source) {
+
+	if (target == NULL || source == NULL) {
+		return AS_NULL_ARGUMENT;
+	}
+
+	//first walk validates, second walk subtracts
+	bool by_key = ASSameKeys(target, source);
+	for (int walk = 0; walk < 2; walk++) {
+		if (walk == 1 && ASMakeExclusive(target) != AS_SUCCESS) {
+			return AS_OUT_OF_MEMORY;
+		}
+		ASElementNode target_ptr = target->head;
+		for (ASElementNode source_ptr = source->head; source_ptr != NULL;
+		     source_ptr = source_ptr->next) {
+			while (target_ptr != NULL && ASCompareNodes(target, by_key,
+			                                  target_ptr, source_ptr) < 0) {
+				target_ptr = target_ptr->next;//forwarding
+			}
+			if (target_ptr == NULL || ASCompareNodes(target, by_key,
+			                                  target_ptr, source_ptr) != 0) {
+				return AS_ITEM_DOES_NOT_EXIST;
+			}
+			if (target_ptr->amount < source_ptr->amount) {
+				return AS_INSUFFICIENT_AMOUNT;
+			}
+			if (walk == 1) {
+				target_ptr->amount -= source_ptr->amount;
+			}
+		}
+	}
+
+	target->iterator = NULL; //reset iterators
+	source->iterator = NULL;
+	return AS_SUCCESS;
+}
+
+AmountSetResult asIntersect(AmountSet target, AmountSet source) {
+
+	if (target == NULL || source == NULL) {
+		return AS_NULL_ARGUMENT;
+	}
+	if (ASMakeExclusive(target) != AS_SUCCESS) {
+		return AS_OUT_OF_MEMORY;
+	}
+	ASDirectoryDrop(target);//the walk is linear anyway
+
+	//walks both sets in parallel, removes target nodes missing in source
+	bool by_key = ASSameKeys(target, source);
+	ASElementNode prev_node_ptr = NULL;
+	ASElementNode target_ptr = target->head;
+	ASElementNode source_ptr = source->head;
+	while (target_ptr != NULL) {
+		while (source_ptr != NULL &&
+		       ASCompareNodes(target, by_key, source_ptr, target_ptr) < 0) {
+			source_ptr = source_ptr->next;//forwarding
+		}
+		ASElementNode next_node = target_ptr->next;
+		if (source_ptr != NULL &&
+		    ASCompareNodes(target, by_key, source_ptr, target_ptr) == 0) {
+			if (source_ptr->amount < target_ptr->amount) {
+				target_ptr->amount = source_ptr->amount;
+			}
+			prev_node_ptr = target_ptr;
+		}
+		else {
+			ASElementNodeRemove(target, prev_node_ptr, target_ptr);
+		}
+		target_ptr = next_node;
+	}
+
+	target->iterator = NULL; //reset iterators
+	source->iterator = NULL;
+	return AS_SUCCESS;
+}
+
+ASElement asGetLowerBound(AmountSet set, ASElement key) {
+
+	if (set == NULL || key == NULL) {
+		return NULL;
+	}
+
+	//stops at the first node that isnt smaller than key
+	ASSearchKey search_key = ASSearchKeyOf(set, key);
+	ASElementNode node_ptr = set->head;
+	if (ASDirectoryUse(set)) {
+		int position = ASDirectoryLowerBound(set, search_key.key);
+		node_ptr = (position < set->size) ?
+		           set->directory.nodes[position] : NULL;
+	}
+	while (node_ptr != NULL && ASCompareNode(set, node_ptr, &search_key) < 0) {
+		COUNT_VISIT(set);
+		node_ptr = node_ptr->next;//forwarding
+	}
+
+	//setting iterator to be the found node and returns its element
+	set->iterator = node_ptr;
+	return (set->iterator == NULL) ? NULL : set->iterator->element;
+}
+
+AmountSetResult asGetCurrentAmount(AmountSet set, double* outAmount) {
+
+	if (set == NULL || outAmount == NULL) {
+		return AS_NULL_ARGUMENT;
+	}
+	if (set->iterator == NULL) {
+		return AS_ITEM_DOES_NOT_EXIST;
+	}
+
+	*outAmount = set->iterator->amount;
+	return AS_SUCCESS;
+}
+
+ASCursor asCursorCreate(AmountSet set) {
+
+	if (set == NULL) {
+		return NULL;
+	}
+
+	//allocates cursor and registers it in the set
+	ASCursor cursor = mtmAllocate(set->allocator, sizeof(*cursor));
+	if (cursor == NULL) {
+		return NULL;
+	}
+	cursor->set = set;
+	cursor->allocator = set->allocator;
+	cursor->prev = NULL;
+	cursor->node = set->head;
+	cursor->next_cursor = set->cursors;
+	set->cursors = cursor;
+	return cursor;
+}
+
+void asCursorDestroy(ASCursor cursor) {
+
+	if (cursor == NULL) {
+		return;
+	}
+	if (cursor->set == NULL) {//set was destroyed, cursor is detached
+		mtmRelease(cursor->allocator, cursor);
+		return;
+	}
+
+	//unregisters cursor from its set
+	AmountSet set = cursor->set;
+	ASCursor* cursor_ptr = &set->cursors;
+	while (*cursor_ptr != cursor) {
+		cursor_ptr = &(*cursor_ptr)->next_cursor;
+	}
+	*cursor_ptr = cursor->next_cursor;
+	mtmRelease(cursor->allocator, cursor);
+}
+
+ASElement asCursorGet(ASCursor cursor) {
+	return (cursor == NULL || cursor->set == NULL || cursor->node == NULL) ?
+	       NULL : cursor->node->element;
+}
+
+AmountSetResult asCursorGetAmount(ASCursor cursor, double* outAmount) {
+
+	if (cursor == NULL || outAmount == NULL) {
+		return AS_NULL_ARGUMENT;
+	}
+	if (cursor->set == NULL || cursor->node == NULL) {
+		return AS_ITEM_DOES_NOT_EXIST;
+	}
+	*outAmount = cursor->node->amount;
+	return AS_SUCCESS;
+}
+
+ASElement asCursorNext(ASCursor cursor) {
+
+	if (cursor == NULL || cursor->set == NULL || cursor->node == NULL) {
+		return NULL;
+	}
+	cursor->prev = cursor->node;
+	cursor->node = cursor->node->next;
+	return (cursor->node == NULL) ? NULL : cursor->node->element;
+}
+
+ASElement asCursorSeek(ASCursor cursor, ASElement key) {
+
+	if (cursor == NULL || key == NULL || cursor->set == NULL) {
+		return NULL;
+	}
+
+	//same walk as asGetLowerBound, keeping the previous node
+	AmountSet set = cursor->set;
+	ASSearchKey search_key = ASSearchKeyOf(set, key);
+	cursor->prev = NULL;
+	cursor->node = set->head;
+	if (ASDirectoryUse(set)) {
+		int position = ASDirectoryLowerBound(set, search_key.key);
+		cursor->prev = (position == 0) ? NULL :
+		               set->directory.nodes[position - 1];
+		cursor->node = (position < set->size) ?
+		               set->directory.nodes[position] : NULL;
+	}
+	while (cursor->node != NULL &&
+	       ASCompareNode(set, cursor->node, &search_key) < 0) {
+		COUNT_VISIT(set);
+		cursor->prev = cursor->node;
+		cursor->node = cursor->node->next;
+	}
+	return (cursor->node == NULL) ? NULL : cursor->node->element;
+}
+
+AmountSetResult asCursorDelete(ASCursor cursor) {
+
+	if (cursor == NULL) {
+		return AS_NULL_ARGUMENT;
+	}
+	if (cursor->set == NULL || cursor->node == NULL) {
+		return AS_ITEM_DOES_NOT_EXIST;
+	}
+
+	if (ASMakeExclusive(cursor->set) != AS_SUCCESS) {
+		return AS_OUT_OF_MEMORY;
+	}
+
+	//removing moves this cursor (and any other on the node) forward
+	ASElementNodeRemove(cursor->set, cursor->prev, cursor->node);
+	cursor->set->iterator = NULL; //reset iterator
+	return AS_SUCCESS;
+}
+
+AmountSetResult asReplaceCurrent(AmountSet set, ASElement element) {
+
+	if (set == NULL || element == NULL) {
+		return AS_NULL_ARGUMENT;
+	}
+	if (set->iterator == NULL) {
+		return AS_ITEM_DOES_NOT_EXIST;
+	}
+	if (ASMakeExclusive(set) != AS_SUCCESS) {//moves the iterator
+		return AS_OUT_OF_MEMORY;
+	}
+	assert(set->cmpASElement(set->iterator->element, element) == 0);
+	set->freeASElement(set->iterator->element);
+	set->iterator->element = element;
+	return AS_SUCCESS;
+}
+
+void asSetCopyOnWrite(AmountSet set, bool enabled) {
+	if (set != NULL) {
+		set->copy_on_write = enabled;
+	}
+}
+
+AmountSetResult asUnshare(AmountSet set) {
+	return (set == NULL) ? AS_NULL_ARGUMENT : ASMakeExclusive(set);
+}
+
+AmountSetResult asReserve(AmountSet set, int capacity) {
+
+	if (set == NULL) {
+		return AS_NULL_ARGUMENT;
+	}
+	set->capacity = (capacity > 0) ? capacity : 0;
+	ASSparesRelease(set, (set->capacity > set->size) ?
+	                     set->capacity - set->size : 0);
+	while (set->size + set->num_spares < set->capacity) {
+		ASElementNode spare = mtmAllocate(set->allocator, sizeof(*spare));
+		if (spare == NULL) {
+			return AS_OUT_OF_MEMORY;//the allocated spares are kept
+		}
+		mtmMemoryAdd(set->memory, 0, sizeof(*spare));
+		spare->next = set->spares;
+		set->spares = spare;
+		set->num_spares++;
+	}
+
+	//builds the directory now, with room for the reserved size
+	if (set->directory.capacity < set->capacity) {
+		ASDirectoryDrop(set);
+		ASDirectoryUse(set);
+	}
+	return AS_SUCCESS;
+}
+
+AmountSetResult asSetReadOnly(AmountSet set) {
+
+	if (set == NULL) {
+		return AS_NULL_ARGUMENT;
+	}
+	set->read_only = false;
+	if (!ASDirectoryUse(set) && set->getKey != NULL &&
+	    set->size >= DIRECTORY_MIN_SIZE) {
+		return AS_OUT_OF_MEMORY;
+	}
+	set->read_only = true;
+	return AS_SUCCESS;
+}
+
+void asSetMemoryCounter(AmountSet set, MtmMemoryCounter* counter) {
+	if (set != NULL) {
+		assert(set->head == NULL && set->spares == NULL);//nothing counted
+		ASDirectoryDrop(set);
+		set->memory = counter;
+	}
+}
+
+#ifdef MATAMAZOM_STATS
+void asSetVisitCounter(AmountSet set, unsigned long* counter) {
+	if (set != NULL) {
+		set->visit_counter = counter;
+	}
+}
+#endif
@@ -0,0 +1,343 @@
+#ifndef AMOUNT_SET_EXT_H_
+#define AMOUNT_SET_EXT_H_
+#include "amount_set.h"
+#include "mtm_allocator.h"
+
+/*
+extensions of the amount set interface that arent part of amount_set.h
+*/
+
+/*
+asCreateWithAllocator - same as asCreate, but the set, its nodes and its
+copies are allocated with the given allocator
+INPUT:
+	@param copyElement - function to copy elements
+	@param freeElement - function to free elements
+	@param compareElements - function to compare elements
+	@param allocator - allocator to use, must outlive the set
+OUTPUT:
+	the new set, NULL if one of the args is NULL or out of memory
+*/
+AmountSet asCreateWithAllocator(CopyASElement copyElement,
+                                FreeASElement freeElement,
+                                CompareASElements compareElements,
+                                const MtmAllocator* allocator);
+
+/** Type for defining the key function of keyed sets */
+typedef unsigned int (*GetASElementKey)(ASElement);
+
+/*
+asCreateKeyed - same as asCreateWithAllocator, for elements that are
+ordered by an unsigned int key. the key of every element is stored in its
+node, so searches compare integers instead of calling compareElements.
+compareElements must order the elements by their keys, it is still used
+by checks of the generic paths.
+INPUT:
+	@param copyElement - function to copy elements
+	@param freeElement - function to free elements
+	@param compareElements - function to compare elements, by key
+	@param getKey - function returning the key of an element, it must read
+	                only what compareElements reads
+	@param allocator - allocator to use, must outlive the set
+OUTPUT:
+	the new set, NULL if one of the args is NULL or out of memory
+*/
+AmountSet asCreateKeyed(CopyASElement copyElement,
+                        FreeASElement freeElement,
+                        CompareASElements compareElements,
+                        GetASElementKey getKey,
+                        const MtmAllocator* allocator);
+
+/*
+asGetLowerBound - sets the internal iterator to the first element that
+isnt smaller than key (by the set compare function), so iteration with
+asGetNext continues from there
+INPUT:
+	@param set - the amount set
+	@param key - element to compare with, only read by the compare function
+OUTPUT:
+	the first element that isnt smaller than key, NULL if there is none or
+	one of the args is NULL
+*/
+ASElement asGetLowerBound(AmountSet set, ASElement key);
+
+/*
+AS_FOREACH_FROM - iterates the elements that arent smaller than key, in
+order. break out of it once the element passes the upper end of a range
+*/
+#define AS_FOREACH_FROM(type, iterator, set, key) \
+    for (type iterator = (type)asGetLowerBound(set, key); iterator; \
+         iterator = asGetNext(set))
+
+/*
+asGetCurrentAmount - returns the amount of the element the internal
+iterator points to, without searching for it
+INPUT:
+	@param set - the amount set
+	@param outAmount - where the amount is returned
+OUTPUT:
+	AS_NULL_ARGUMENT - if one of the args is NULL
+	AS_ITEM_DOES_NOT_EXIST - if the iterator is in invalid state
+	AS_SUCCESS - otherwise
+*/
+AmountSetResult asGetCurrentAmount(AmountSet set, double* outAmount);
+
+/** Type for defining a single update of asApplyUpdates */
+typedef struct ASUpdate_t {
+	ASElement element;//element to update, registered if missing
+	double amount;//new amount of the element
+	bool remove;//true to delete the element instead
+} ASUpdate;
+
+/*
+asApplyUpdates - applies many updates to the set in one ordered walk.
+missing elements are registered with the given amount, existing elements
+get the given amount (it isnt added) and removed elements are deleted,
+removing a missing element does nothing. either all updates are applied
+or, if memory runs out, none of them.
+INPUT:
+	@param set - the amount set
+	@param updates - updates sorted by the set compare function, with no
+	                 two updates of the same element
+	@param count - number of updates
+OUTPUT:
+	AS_NULL_ARGUMENT - if set is NULL or updates is NULL and count > 0
+	AS_OUT_OF_MEMORY - if allocation failed, the set isnt changed
+	AS_SUCCESS - otherwise
+	the internal iterator is reset.
+*/
+AmountSetResult asApplyUpdates(AmountSet set, const ASUpdate* updates,
+                               int count);
+
+/*
+set algebra on two sets that are ordered by the same compare function.
+each operation changes target in place in one parallel walk of both
+sets, O(size of target + size of source), and resets their iterators.
+*/
+
+/*
+asMerge - adds the amounts of source to target, elements that are missing
+in target are registered (copied) with their source amount
+INPUT:
+	@param target - set to change
+	@param source - set to add
+OUTPUT:
+	AS_NULL_ARGUMENT - if one of the args is NULL
+	AS_OUT_OF_MEMORY - if allocation failed, target isnt changed
+	AS_SUCCESS - otherwise
+*/
+AmountSetResult asMerge(AmountSet target, AmountSet source);
+
+/*
+asSubtract - subtracts the amounts of source from target, elements whose
+amount drops to 0 stay in target
+INPUT:
+	@param target - set to change
+	@param source - set to subtract
+OUTPUT:
+	AS_NULL_ARGUMENT - if one of the args is NULL
+	AS_ITEM_DOES_NOT_EXIST - if an element of source isnt in target
+	AS_INSUFFICIENT_AMOUNT - if an amount in target is smaller than in source
+	AS_SUCCESS - otherwise. target is changed only on success
+*/
+AmountSetResult asSubtract(AmountSet target, AmountSet source);
+
+/*
+asIntersect - removes from target the elements that arent in source, the
+remaining elements get the smaller of their two amounts
+INPUT:
+	@param target - set to change
+	@param source - set to intersect with
+OUTPUT:
+	AS_NULL_ARGUMENT - if one of the args is NULL
+	AS_SUCCESS - otherwise
+*/
+AmountSetResult asIntersect(AmountSet target, AmountSet source);
+
+/*
+cursors are caller owned iterators over a set. any number of them can walk
+a set at once, independently of each other and of the internal iterator
+used by asGetFirst/asGetNext. they stay valid when the set changes:
+a cursor whose element is deleted moves to the next element, and elements
+registered right before a cursor are skipped by it. once the set is
+destroyed its cursors are detached (they are at the end) and must still
+be destroyed.
+*/
+
+/** Type for defining a cursor over an amount set */
+typedef struct ASCursor_t* ASCursor;
+
+/*
+asCursorCreate - creates a cursor on the first element of the set
+INPUT:
+	@param set - the amount set
+OUTPUT:
+	the cursor, NULL if set is NULL or out of memory
+*/
+ASCursor asCursorCreate(AmountSet set);
+
+/*
+asCursorDestroy - destroys a cursor
+INPUT:
+	@param cursor - cursor to destroy, may be NULL
+*/
+void asCursorDestroy(ASCursor cursor);
+
+/*
+asCursorGet - returns the element of the cursor
+INPUT:
+	@param cursor - the cursor
+OUTPUT:
+	the element, NULL if the cursor is at the end or NULL
+*/
+ASElement asCursorGet(ASCursor cursor);
+
+/*
+asCursorGetAmount - returns the amount of the element of the cursor, O(1)
+INPUT:
+	@param cursor - the cursor
+	@param outAmount - where the amount is returned
+OUTPUT:
+	AS_NULL_ARGUMENT - if one of the args is NULL
+	AS_ITEM_DOES_NOT_EXIST - if the cursor is at the end
+	AS_SUCCESS - otherwise
+*/
+AmountSetResult asCursorGetAmount(ASCursor cursor, double* outAmount);
+
+/*
+asCursorNext - advances the cursor to the next element, O(1)
+INPUT:
+	@param cursor - the cursor
+OUTPUT:
+	the new element of the cursor, NULL if it reached the end
+*/
+ASElement asCursorNext(ASCursor cursor);
+
+/*
+asCursorSeek - moves the cursor to the first element that isnt smaller
+than key, like asGetLowerBound
+INPUT:
+	@param cursor - the cursor
+	@param key - element to compare with, only read by the compare function
+OUTPUT:
+	the new element of the cursor, NULL if there is none
+*/
+ASElement asCursorSeek(ASCursor cursor, ASElement key);
+
+/*
+asCursorDelete - deletes the element of the cursor in O(1), the cursor
+moves to the next element. the internal iterator is reset.
+INPUT:
+	@param cursor - the cursor
+OUTPUT:
+	AS_NULL_ARGUMENT - if cursor is NULL
+	AS_ITEM_DOES_NOT_EXIST - if the cursor is at the end
+	AS_SUCCESS - otherwise
+*/
+AmountSetResult asCursorDelete(ASCursor cursor);
+
+/*
+asSetCopyOnWrite - sets the copy mode of the set. in copy on write mode
+asCopy is O(1): the copy shares the nodes, elements and key directory of
+the set, and the first change of either set copies the nodes of that set
+only (with the copy function, which may share the elements instead of
+copying them) and fills its own directory in the same walk.
+copies of a copy on write set are copy on write as well.
+elements of such sets must not be changed in place (through the pointers
+returned by the getters), since the change would show in every copy.
+a change of a shared set may fail with AS_OUT_OF_MEMORY.
+INPUT:
+	@param set - the amount set
+	@param enabled - true for copy on write, false to copy on asCopy
+*/
+void asSetCopyOnWrite(AmountSet set, bool enabled);
+
+/*
+asReplaceCurrent - replaces the element the internal iterator points to by
+element, which must be equal to it by the compare function (and have the
+same key). the set takes element as is, without copying it, and frees the
+replaced one, so a copy function that shares elements (e.g. by a reference
+count) lets the set copy only the elements that change. if copies share
+the nodes, they are copied first. the iterator stays on the element.
+INPUT:
+	@param set - the amount set
+	@param element - the new element
+OUTPUT:
+	AS_NULL_ARGUMENT - if one of the args is NULL
+	AS_ITEM_DOES_NOT_EXIST - if the iterator is in invalid state
+	AS_OUT_OF_MEMORY - if copying the shared nodes failed, element isnt
+	                   taken then
+	AS_SUCCESS - otherwise
+*/
+AmountSetResult asReplaceCurrent(AmountSet set, ASElement element);
+
+/*
+asUnshare - makes the nodes and elements of a copy on write set its own,
+so its elements can be changed in place without the change showing in
+its copies. O(1) if no copy shares them, else they are copied (the
+elements with the copy function of the set, if it shares them instead of
+copying them, see asReplaceCurrent).
+INPUT:
+	@param set - the amount set
+OUTPUT:
+	AS_NULL_ARGUMENT - if set is NULL
+	AS_OUT_OF_MEMORY - if copying failed, the set still shares its nodes
+	AS_SUCCESS - otherwise
+*/
+AmountSetResult asUnshare(AmountSet set);
+
+/*
+asReserve - reserves room for capacity elements. the missing nodes are
+allocated ahead and kept as spares, so registering elements up to
+capacity (and the copying of a copy on write set) takes nodes from them
+instead of allocating, and nodes of deleted elements are kept as spares
+while the set is below capacity. the key directory of a big keyed set is
+built with room for capacity. copies of the set dont reserve.
+INPUT:
+	@param set - the amount set
+	@param capacity - number of elements, spares above it are freed
+OUTPUT:
+	AS_NULL_ARGUMENT - if set is NULL
+	AS_OUT_OF_MEMORY - if allocation failed, the allocated spares are kept
+	AS_SUCCESS - otherwise
+*/
+AmountSetResult asReserve(AmountSet set, int capacity);
+
+/*
+asSetReadOnly - prepares a set that wont change anymore to be read by
+another thread: the key directory of a big keyed set is built now, and
+searches of the set dont allocate or update the memory counter after it.
+only the internal iterator of the set is changed by reads, its cursors
+are still allocated. O(1) if the set already has a directory or shares
+the nodes of a set that has one (asSetCopyOnWrite), else O(n)
+INPUT:
+	@param set - the amount set, it must not be changed afterwards
+OUTPUT:
+	AS_NULL_ARGUMENT - if set is NULL
+	AS_OUT_OF_MEMORY - if building the directory failed
+	AS_SUCCESS - otherwise
+*/
+AmountSetResult asSetReadOnly(AmountSet set);
+
+/*
+asSetMemoryCounter - sets a counter of the nodes the set allocates (count)
+and of the bytes of its nodes and key directory. copies of the set share
+it, copy on write copies count their nodes once.
+INPUT:
+	@param set - an empty amount set, with no spare nodes
+	@param counter - counter to update, NULL to stop counting
+*/
+void asSetMemoryCounter(AmountSet set, MtmMemoryCounter* counter);
+
+#ifdef MATAMAZOM_STATS
+/*
+asSetVisitCounter - sets a counter that is increased for every node the
+set visits while searching for an element. copies of the set share it.
+INPUT:
+	@param set - the amount set
+	@param counter - counter to increase, NULL to stop counting
+*/
+void asSetVisitCounter(AmountSet set, unsigned long* counter);
+#endif
+
+#endif //AMOUNT_SET_EXT_H_
@@ -0,0 +1,148 @@
+#include "change_feed.h"
+#include <stdlib.h>
+#include <assert.h>
+
+//defining change feed
+struct ChangeFeed_t {
+	MtmChange* changes;//ring, change seq is at index seq & mask
+	unsigned long mask;//capacity - 1
+	int size;//changes kept, up to capacity
+	unsigned long last_seq;//sequence number of the newest change
+	unsigned long delivered_seq;//last change delivered to the listener
+	MtmChangeListener listener;
+	int batch;
+	void* context;
+	const MtmAllocator* allocator;
+	MtmMemoryCounter* memory;//counter of the ring, may be NULL
+};
+
+/*
+getOldestSeq - returns the sequence number of the oldest change kept,
+last_seq + 1 while the feed is empty
+INPUT:
+	@param feed - the feed
+*/
+static unsigned long getOldestSeq(ChangeFeed feed) {
+	return feed->last_seq - (unsigned long)feed->size + 1;
+}
+
+ChangeFeed changeFeedCreate(int capacity, unsigned long last_seq,
+                            const MtmAllocator* allocator,
+                            MtmMemoryCounter* counter) {
+
+	if (capacity <= 0 || capacity > CHANGE_FEED_MAX_CAPACITY ||
+	    allocator == NULL) {
+		return NULL;
+	}
+	int rounded = 1;
+	while (rounded < capacity) {
+		rounded *= 2;
+	}
+
+	ChangeFeed feed = mtmAllocate(allocator, sizeof(*feed));
+	if (feed == NULL) {
+		return NULL;
+	}
+	feed->changes = mtmAllocate(allocator, rounded * sizeof(*feed->changes));
+	if (feed->changes == NULL) {
+		mtmRelease(allocator, feed);
+		return NULL;
+	}
+	feed->mask = rounded - 1;
+	feed->size = 0;
+	feed->last_seq = last_seq;
+	feed->delivered_seq = last_seq;
+	feed->listener = NULL;
+	feed->batch = 1;
+	feed->context = NULL;
+	feed->allocator = allocator;
+	feed->memory = counter;
+	mtmMemoryAdd(counter, rounded, rounded * sizeof(*feed->changes));
+	return feed;
+}
+
+void changeFeedDestroy(ChangeFeed feed) {
+
+	if (feed == NULL) {
+		return;
+	}
+	mtmMemorySub(feed->memory, feed->mask + 1,
+	             (feed->mask + 1) * sizeof(*feed->changes));
+	mtmRelease(feed->allocator, feed->changes);
+	mtmRelease(feed->allocator, feed);
+}
+
+void changeFeedAppend(ChangeFeed feed, MtmChangeType type,
+                      unsigned int product_id, unsigned int order_id,
+                      double amount) {
+
+	assert(feed != NULL);
+	MtmChange* change = &feed->changes[++feed->last_seq & feed->mask];
+	change->seq = feed->last_seq;
+	change->type = type;
+	change->product_id = product_id;
+	change->order_id = order_id;
+	change->amount = amount;
+	if ((unsigned long)feed->size <= feed->mask) {
+		feed->size++;
+	}
+}
+
+unsigned long changeFeedLastSeq(ChangeFeed feed) {
+	assert(feed != NULL);
+	return feed->last_seq;
+}
+
+int changeFeedRead(ChangeFeed feed, unsigned long after_seq,
+                   MtmChange* changes, int max) {
+
+	assert(feed != NULL && (changes != NULL || max <= 0));
+	unsigned long seq = getOldestSeq(feed);
+	if (after_seq >= seq) {
+		seq = after_seq + 1;
+	}
+	int count = 0;
+	for (; count < max && seq <= feed->last_seq; seq++) {
+		changes[count++] = feed->changes[seq & feed->mask];
+	}
+	return count;
+}
+
+void changeFeedSetListener(ChangeFeed feed, MtmChangeListener listener,
+                           int batch, void* context) {
+
+	assert(feed != NULL);
+	assert(listener == NULL ||
+	       (batch > 0 && (unsigned long)batch <= feed->mask + 1));
+	feed->listener = listener;
+	feed->batch = batch;
+	feed->context = context;
+	feed->delivered_seq = feed->last_seq;
+}
+
+void changeFeedPublish(ChangeFeed feed, bool flush) {
+
+	assert(feed != NULL);
+	if (feed->listener == NULL) {
+		return;
+	}
+	//skips the changes that were overwritten before delivery
+	if (feed->delivered_seq + 1 < getOldestSeq(feed)) {
+		feed->delivered_seq = getOldestSeq(feed) - 1;
+	}
+	unsigned long pending = feed->last_seq - feed->delivered_seq;
+	if (pending == 0 || (!flush && pending < (unsigned long)feed->batch)) {
+		return;
+	}
+
+	//the changes are delivered in place, in two parts if the ring wraps
+	while (feed->delivered_seq < feed->last_seq) {
+		unsigned long index = (feed->delivered_seq + 1) & feed->mask;
+		unsigned long count = feed->last_seq - feed->delivered_seq;
+		if (count > feed->mask + 1 - index) {
+			count = feed->mask + 1 - index;
+		}
+		feed->delivered_seq += count;
+		feed->listener(&feed->changes[index], (int)count, feed->context);
+	}
+}
@@ -0,0 +1,132 @@
+#ifndef CHANGE_FEED_H_
+#define CHANGE_FEED_H_
+#include <stdbool.h>
+#include "mtm_allocator.h"
+
+/*
+ring of the last changes of a warehouse, for mirrors that follow it
+incrementally. every change gets the next sequence number, once the ring
+is full the oldest change is overwritten. readers poll the changes after
+the last sequence number they saw, a listener gets them in batches.
+*/
+
+//largest capacity of a feed
+#define CHANGE_FEED_MAX_CAPACITY (1 << 30)
+
+/** Type for defining the kinds of changes */
+typedef enum MtmChangeType_t {
+	MTM_CHANGE_PRODUCT_ADDED,//product_id was added with amount
+	MTM_CHANGE_PRODUCT_CLEARED,//product_id was removed from the storage
+	                           //and from every order
+	MTM_CHANGE_AMOUNT_CHANGED,//product_id has amount in the storage now
+	MTM_CHANGE_ORDER_CREATED,//order_id was created empty
+	MTM_CHANGE_ORDER_LINE_CHANGED,//product_id has amount in order_id now,
+	                              //0 if the line was removed
+	MTM_CHANGE_ORDER_SHIPPED,//order_id was shipped and removed
+	MTM_CHANGE_ORDER_CANCELLED,//order_id was cancelled and removed
+	MTM_CHANGE_ORDER_MERGED//order_id was merged into another order and
+	                       //removed, the lines it changed come before it
+} MtmChangeType;
+
+/** Type for defining a change record, unused ids and amounts are 0 */
+typedef struct MtmChange_t {
+	unsigned long seq;//sequence number, the first change is 1
+	MtmChangeType type;
+	unsigned int product_id;
+	unsigned int order_id;
+	double amount;//new amount, not the difference
+} MtmChange;
+
+/*
+Type for defining a listener of changes, called with count > 0 changes
+in sequence order. changes is valid only during the call.
+*/
+typedef void (*MtmChangeListener)(const MtmChange* changes, int count,
+                                  void* context);
+
+/** Type for defining a change feed */
+typedef struct ChangeFeed_t* ChangeFeed;
+
+/*
+changeFeedCreate - creates an empty feed
+INPUT:
+	@param capacity - number of changes kept, rounded up to a power of 2
+	@param last_seq - sequence number of the change before the first one
+	@param allocator - allocator of the feed, must outlive it
+	@param counter - counter of the slots of the ring and their bytes, may
+	                 be NULL
+OUTPUT:
+	the new feed, NULL if capacity isnt positive or too big, allocator
+	is NULL or out of memory
+*/
+ChangeFeed changeFeedCreate(int capacity, unsigned long last_seq,
+                            const MtmAllocator* allocator,
+                            MtmMemoryCounter* counter);
+
+/*
+changeFeedDestroy - destroys the feed, changes that werent delivered to
+its listener are dropped
+INPUT:
+	@param feed - feed to destroy, may be NULL
+*/
+void changeFeedDestroy(ChangeFeed feed);
+
+/*
+changeFeedAppend - appends a change, overwriting the oldest one if the
+feed is full. O(1), the listener isnt called
+INPUT:
+	@param feed - the feed
+	@param type - kind of change
+	@param product_id - product of the change, 0 if none
+	@param order_id - order of the change, 0 if none
+	@param amount - new amount, 0 if none
+*/
+void changeFeedAppend(ChangeFeed feed, MtmChangeType type,
+                      unsigned int product_id, unsigned int order_id,
+                      double amount);
+
+/*
+changeFeedLastSeq - returns the sequence number of the last change
+INPUT:
+	@param feed - the feed
+*/
+unsigned long changeFeedLastSeq(ChangeFeed feed);
+
+/*
+changeFeedRead - copies the oldest changes after a sequence number that
+the feed still keeps
+INPUT:
+	@param feed - the feed
+	@param after_seq - last sequence number the reader saw
+	@param changes - where the changes are copied to
+	@param max - room in changes
+OUTPUT:
+	number of changes copied. the first of them isnt after_seq + 1 if the
+	changes in between were overwritten
+*/
+int changeFeedRead(ChangeFeed feed, unsigned long after_seq,
+                   MtmChange* changes, int max);
+
+/*
+changeFeedSetListener - sets the listener of the feed, changes appended
+from now on are delivered to it
+INPUT:
+	@param feed - the feed
+	@param listener - the listener, NULL for none
+	@param batch - number of changes delivered together, 1 to capacity
+	@param context - passed as is to listener
+*/
+void changeFeedSetListener(ChangeFeed feed, MtmChangeListener listener,
+                           int batch, void* context);
+
+/*
+changeFeedPublish - delivers the undelivered changes to the listener, if
+there are at least batch of them or flush is true. changes that were
+overwritten before they were delivered are skipped.
+INPUT:
+	@param feed - the feed
+	@param flush - true to deliver less than batch changes as well
+*/
+void changeFeedPublish(ChangeFeed feed, bool flush);
+
+#endif //CHANGE_FEED_H_
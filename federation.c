@@ -0,0 +1,379 @@
+#define _POSIX_C_SOURCE 200809L
+#include "federation.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
+#include "matamazom_ext.h"
+#include "matamazom_print.h"
+
+//defining shard, a warehouse and its lock
+typedef struct FederationShard_t {
+	Matamazom matamazom;
+	pthread_mutex_t lock;//held while using the warehouse
+} FederationShard;
+
+//defining federation
+struct MtmFederation_t {
+	FederationShard* shards;
+	unsigned int* bounds;//bounds[i] is the lowest id of shard i + 1
+	int num_shards;
+};
+
+//part of a federated order, the order of one shard
+typedef struct FederationPart_t {
+	int shard;
+	unsigned int order_id;//0 until the order is created
+} FederationPart;
+
+/*
+getShardIndex - returns the shard that owns an id, O(log shards)
+INPUT:
+	@param federation - the federation
+	@param id - the id
+OUTPUT:
+	index of the shard
+*/
+static int getShardIndex(MtmFederation federation, unsigned int id) {
+
+	//counts the bounds that arent bigger than id
+	int low = 0, high = federation->num_shards - 1;
+	while (low < high) {
+		int middle = low + (high - low) / 2;
+		if (federation->bounds[middle] <= id) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/*
+lockShard, unlockShard - lock and unlock a shard. several shards are
+always locked by ascending index, so threads cant deadlock
+INPUT:
+	@param federation - the federation
+	@param shard - index of the shard
+*/
+static void lockShard(MtmFederation federation, int shard) {
+	pthread_mutex_lock(&federation->shards[shard].lock);
+}
+
+static void unlockShard(MtmFederation federation, int shard) {
+	pthread_mutex_unlock(&federation->shards[shard].lock);
+}
+
+/*
+lockAllShards, unlockAllShards - lock and unlock every shard, for reports
+INPUT:
+	@param federation - the federation
+*/
+static void lockAllShards(MtmFederation federation) {
+	for (int i = 0; i < federation->num_shards; i++) {
+		lockShard(federation, i);
+	}
+}
+
+static void unlockAllShards(MtmFederation federation) {
+	for (int i = federation->num_shards - 1; i >= 0; i--) {
+		unlockShard(federation, i);
+	}
+}
+
+/*
+compareFederationLines - qsort compare of order lines, by product id
+*/
+static int compareFederationLines(const void* line1, const void* line2) {
+
+	unsigned int first = ((const MtmFederationLine*)line1)->product_id;
+	unsigned int second = ((const MtmFederationLine*)line2)->product_id;
+	return (first > second) - (first < second);
+}
+
+/*
+acceptProduct - filter of mtmPrintFiltered that accepts every product
+*/
+static bool acceptProduct(const unsigned int id, const char* name,
+                          const double amount, MtmProductData customData) {
+	(void)id;
+	(void)name;
+	(void)amount;
+	(void)customData;
+	return true;
+}
+
+/*
+prepareFederationParts - first phase of mtmFederationShipOrder: locks
+the shards of the lines, by ascending index, creates their orders and
+prepares them
+INPUT:
+	@param federation - the federation
+	@param lines - lines sorted by product id
+	@param count - number of lines
+	@param parts - where the parts are kept, room for count parts
+	@param num_parts - where the number of locked shards is returned
+OUTPUT:
+	the first failure of a shard, else MATAMAZOM_SUCCESS
+*/
+static MatamazomResult prepareFederationParts(MtmFederation federation,
+        const MtmFederationLine* lines, int count, FederationPart* parts,
+        int* num_parts) {
+
+	*num_parts = 0;
+	for (int i = 0; i < count; i++) {
+		int shard = getShardIndex(federation, lines[i].product_id);
+		Matamazom matamazom = federation->shards[shard].matamazom;
+		if (*num_parts == 0 || parts[*num_parts - 1].shard != shard) {
+			lockShard(federation, shard);//next shard
+			FederationPart* part = &parts[(*num_parts)++];
+			part->shard = shard;
+			part->order_id = mtmCreateNewOrder(matamazom);
+			if (part->order_id == 0) {
+				return MATAMAZOM_OUT_OF_MEMORY;
+			}
+		}
+		MatamazomResult result = mtmChangeProductAmountInOrder(matamazom,
+		        parts[*num_parts - 1].order_id, lines[i].product_id,
+		        lines[i].amount);
+		if (result != MATAMAZOM_SUCCESS) {
+			return result;
+		}
+	}
+
+	for (int i = 0; i < *num_parts; i++) {
+		MatamazomResult result = mtmPrepareShipOrder(
+			federation->shards[parts[i].shard].matamazom, parts[i].order_id);
+		if (result != MATAMAZOM_SUCCESS) {
+			return result;
+		}
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+MtmFederation mtmFederationCreate(const unsigned int* bounds, int count) {
+
+	if (count < 0 || (bounds == NULL && count > 0)) {
+		return NULL;
+	}
+	for (int i = 1; i < count; i++) {
+		if (bounds[i - 1] >= bounds[i]) {
+			return NULL;
+		}
+	}
+
+	MtmFederation federation = malloc(sizeof(*federation));
+	if (federation == NULL) {
+		return NULL;
+	}
+	federation->bounds = malloc((count + 1) * sizeof(*federation->bounds));
+	federation->shards = malloc((count + 1) * sizeof(*federation->shards));
+	if (federation->bounds == NULL || federation->shards == NULL) {
+		free(federation->bounds);
+		free(federation->shards);
+		free(federation);
+		return NULL;
+	}
+	if (count > 0) {
+		memcpy(federation->bounds, bounds, count * sizeof(*bounds));
+	}
+
+	//creates the shards, num_shards counts the created ones
+	for (federation->num_shards = 0; federation->num_shards <= count;
+	     federation->num_shards++) {
+		FederationShard* shard = &federation->shards[federation->num_shards];
+		shard->matamazom = matamazomCreate();
+		if (shard->matamazom == NULL) {
+			mtmFederationDestroy(federation);
+			return NULL;
+		}
+		pthread_mutex_init(&shard->lock, NULL);
+	}
+	return federation;
+}
+
+void mtmFederationDestroy(MtmFederation federation) {
+
+	if (federation == NULL) {
+		return;
+	}
+	for (int i = 0; i < federation->num_shards; i++) {
+		matamazomDestroy(federation->shards[i].matamazom);
+		pthread_mutex_destroy(&federation->shards[i].lock);
+	}
+	free(federation->shards);
+	free(federation->bounds);
+	free(federation);
+}
+
+MatamazomResult mtmFederationNewProduct(MtmFederation federation,
+        const unsigned int id, const char* name, const double amount,
+        const MatamazomAmountType amountType,
+        const MtmProductData customData, MtmCopyData copyData,
+        MtmFreeData freeData, MtmGetProductPrice prodPrice) {
+
+	if (federation == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	int shard = getShardIndex(federation, id);
+	lockShard(federation, shard);
+	MatamazomResult result = mtmNewProduct(
+		federation->shards[shard].matamazom, id, name, amount, amountType,
+		customData, copyData, freeData, prodPrice);
+	unlockShard(federation, shard);
+	return result;
+}
+
+MatamazomResult mtmFederationChangeProductAmount(MtmFederation federation,
+        const unsigned int id, const double amount) {
+
+	if (federation == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	int shard = getShardIndex(federation, id);
+	lockShard(federation, shard);
+	MatamazomResult result = mtmChangeProductAmount(
+		federation->shards[shard].matamazom, id, amount);
+	unlockShard(federation, shard);
+	return result;
+}
+
+MatamazomResult mtmFederationClearProduct(MtmFederation federation,
+                                          const unsigned int id) {
+
+	if (federation == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	int shard = getShardIndex(federation, id);
+	lockShard(federation, shard);
+	MatamazomResult result = mtmClearProduct(
+		federation->shards[shard].matamazom, id);
+	unlockShard(federation, shard);
+	return result;
+}
+
+MatamazomResult mtmFederationShipOrder(MtmFederation federation,
+                                       const MtmFederationLine* lines,
+                                       int count) {
+
+	if (federation == NULL || (lines == NULL && count > 0)) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	for (int i = 0; i < count; i++) {
+		if (!(lines[i].amount > 0)) {
+			return MATAMAZOM_INVALID_AMOUNT;
+		}
+	}
+	if (count <= 0) {
+		return MATAMAZOM_SUCCESS;
+	}
+
+	//sorted lines, so the lines of each shard are together
+	MtmFederationLine* sorted = malloc(count * sizeof(*sorted));
+	FederationPart* parts = malloc(count * sizeof(*parts));
+	if (sorted == NULL || parts == NULL) {
+		free(sorted);
+		free(parts);
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	memcpy(sorted, lines, count * sizeof(*sorted));
+	qsort(sorted, count, sizeof(*sorted), compareFederationLines);
+
+	//first phase, then every shard ships its part or none does
+	int num_parts = 0;
+	MatamazomResult result = prepareFederationParts(federation, sorted,
+	                                                count, parts, &num_parts);
+	for (int i = 0; i < num_parts; i++) {
+		Matamazom matamazom = federation->shards[parts[i].shard].matamazom;
+		if (result == MATAMAZOM_SUCCESS) {
+			MatamazomResult shipped = mtmShipOrder(matamazom,
+			                                       parts[i].order_id);
+			assert(shipped == MATAMAZOM_SUCCESS);//prepared, cant fail
+			(void)shipped;
+		}
+		else if (parts[i].order_id != 0) {
+			mtmCancelOrder(matamazom, parts[i].order_id);
+		}
+	}
+	for (int i = num_parts - 1; i >= 0; i--) {
+		unlockShard(federation, parts[i].shard);
+	}
+
+	free(sorted);
+	free(parts);
+	return result;
+}
+
+MatamazomResult mtmFederationPrintInventory(MtmFederation federation,
+                                            FILE* output) {
+
+	if (federation == NULL || output == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+
+	//the shards own ascending ranges, so their products print in order
+	MatamazomResult result = MATAMAZOM_SUCCESS;
+	lockAllShards(federation);
+	fprintf(output, "Inventory Status:\n");
+	for (int i = 0; i < federation->num_shards &&
+	     result == MATAMAZOM_SUCCESS; i++) {
+		result = mtmPrintFiltered(federation->shards[i].matamazom,
+		                          acceptProduct, output);
+	}
+	unlockAllShards(federation);
+	return result;
+}
+
+MatamazomResult mtmFederationPrintBestSelling(MtmFederation federation,
+                                              FILE* output) {
+
+	if (federation == NULL || output == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+
+	//the best of the shards, on equal income the lower id (earlier shard)
+	lockAllShards(federation);
+	unsigned int best_id = 0;
+	double best_income = 0;
+	const char* best_name = NULL;
+	for (int i = 0; i < federation->num_shards; i++) {
+		unsigned int id = 0;
+		double income = 0;
+		const char* name = NULL;
+		if (mtmGetBestSelling(federation->shards[i].matamazom, &id, &income,
+		                      &name) == MATAMAZOM_SUCCESS &&
+		    (best_name == NULL || income > best_income)) {
+			best_id = id;
+			best_income = income;
+			best_name = name;
+		}
+	}
+	fprintf(output, "Best Selling Product:\n");
+	if (best_name != NULL) {
+		mtmPrintIncomeLine(best_name, best_id, best_income, output);
+	}
+	else {
+		fprintf(output, "none\n");
+	}
+	unlockAllShards(federation);
+	return MATAMAZOM_SUCCESS;
+}
+
+MatamazomResult mtmFederationPrintFiltered(MtmFederation federation,
+                                           MtmFilterProduct customFilter,
+                                           FILE* output) {
+
+	if (federation == NULL || customFilter == NULL || output == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	MatamazomResult result = MATAMAZOM_SUCCESS;
+	lockAllShards(federation);
+	for (int i = 0; i < federation->num_shards &&
+	     result == MATAMAZOM_SUCCESS; i++) {
+		result = mtmPrintFiltered(federation->shards[i].matamazom,
+		                          customFilter, output);
+	}
+	unlockAllShards(federation);
+	return result;
+}
@@ -0,0 +1,102 @@
+#ifndef FEDERATION_H_
+#define FEDERATION_H_
+#include <stdio.h>
+#include "matamazom.h"
+
+/*
+federation of warehouses. the product ids are partitioned in ranges over
+several warehouses (shards), each with its own lock, so calls for
+products of different shards run in parallel in different threads.
+calls for a product lock only the shard that owns it. orders that span
+shards are shipped in two phases: every shard involved prepares its part
+and then all of them ship it, or none does. reports lock all the shards
+and merge their results, in id order.
+the federation has no stats of its own (matamazom_stats.h), its calls are
+counted by the entry points they call in the stats of the shards.
+*/
+
+/** Type for defining a federation of warehouses */
+typedef struct MtmFederation_t* MtmFederation;
+
+/** Type for defining a line of an order shipped by a federation */
+typedef struct MtmFederationLine_t {
+	unsigned int product_id;
+	double amount;//amount to ship, lines of the same product are added
+} MtmFederationLine;
+
+/*
+mtmFederationCreate - creates a federation of count + 1 empty shards.
+shard i owns the ids in [bounds[i - 1], bounds[i]), the first shard owns
+the ids below bounds[0] and the last one the ids from bounds[count - 1].
+INPUT:
+	@param bounds - lowest ids of the shards after the first, ascending
+	@param count - number of bounds, 0 for a single shard
+OUTPUT:
+	the federation, NULL if bounds arent ascending, count is negative,
+	bounds is NULL and count is positive, or out of memory
+*/
+MtmFederation mtmFederationCreate(const unsigned int* bounds, int count);
+
+/*
+mtmFederationDestroy - destroys the federation and its shards, it must not
+be used by other threads
+INPUT:
+	@param federation - federation to destroy, may be NULL
+*/
+void mtmFederationDestroy(MtmFederation federation);
+
+/*
+mtmFederationNewProduct, mtmFederationChangeProductAmount,
+mtmFederationClearProduct - same as mtmNewProduct, mtmChangeProductAmount
+and mtmClearProduct, on the shard that owns id. return
+MATAMAZOM_NULL_ARGUMENT if federation is NULL.
+*/
+MatamazomResult mtmFederationNewProduct(MtmFederation federation,
+        const unsigned int id, const char* name, const double amount,
+        const MatamazomAmountType amountType,
+        const MtmProductData customData, MtmCopyData copyData,
+        MtmFreeData freeData, MtmGetProductPrice prodPrice);
+MatamazomResult mtmFederationChangeProductAmount(MtmFederation federation,
+        const unsigned int id, const double amount);
+MatamazomResult mtmFederationClearProduct(MtmFederation federation,
+                                          const unsigned int id);
+
+/*
+mtmFederationShipOrder - ships an order, in two phases over the shards
+that own its products: each of them gets an order of its lines and
+prepares it with mtmPrepareShipOrder, then all of them ship it. if a
+shard fails to prepare, the orders are cancelled and nothing is shipped.
+INPUT:
+	@param federation - the federation
+	@param lines - lines of the order
+	@param count - number of lines
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if federation is NULL, or lines is NULL and
+	                          count is positive
+	MATAMAZOM_INVALID_AMOUNT - if an amount isnt positive or doesnt fit the
+	                           amount type of its product
+	MATAMAZOM_PRODUCT_NOT_EXIST - if a product doesnt exist
+	MATAMAZOM_INSUFFICIENT_AMOUNT - if a shard doesnt have enough of a product
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmFederationShipOrder(MtmFederation federation,
+                                       const MtmFederationLine* lines,
+                                       int count);
+
+/*
+mtmFederationPrintInventory, mtmFederationPrintBestSelling,
+mtmFederationPrintFiltered - same as mtmPrintInventory,
+mtmPrintBestSelling and mtmPrintFiltered, for the products of all the
+shards. the shards are locked during the report, so it sees a consistent
+state of the federation. customFilter must not use the federation.
+*/
+MatamazomResult mtmFederationPrintInventory(MtmFederation federation,
+                                            FILE* output);
+MatamazomResult mtmFederationPrintBestSelling(MtmFederation federation,
+                                              FILE* output);
+MatamazomResult mtmFederationPrintFiltered(MtmFederation federation,
+                                           MtmFilterProduct customFilter,
+                                           FILE* output);
+
+#endif //FEDERATION_H_
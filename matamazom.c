@@ -2,10 +2,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <limits.h>
 #include "matamazom.h"
 #include "list.h"
 #include "order.h"
 #include "matamazom_print.h"
+#include "matamazom_stats.h"
+#include "amount_set_ext.h"
+#include "matamazom_ext.h"
+#include "name_table.h"
+#include "name_index.h"
+#include "sales_history.h"
+#include "sales_velocity.h"
 
 #define ERROR_RANGE 0.001
 #define HALF_INT 0.5
@@ -19,35 +27,156 @@
 #define SINGLE 1
 #define NEGETIVE(x) (-1*x)
 #define DEF_PROFIT -1
+#define EDIT_INITIAL_CAPACITY 16
+#define IMPORT_INITIAL_CAPACITY 64
+#define INLINE_NAME_SIZE 24 //names up to 23 chars are kept in the product
+
+//instrumentation, expands to nothing when compiled without MATAMAZOM_STATS
+#ifdef MATAMAZOM_STATS
+#define STATS_START(start) double start = mtmStatsNow()
+#define STATS_RECORD(matamazom, api, result, start) \
+	mtmStatsRecord(((matamazom) == NULL) ? NULL : &(matamazom)->stats, \
+	               api, result, start)
+//for entry points that dont take the warehouse, stats is read before the
+//call in case the call frees the object it was read from
+#define STATS_SOURCE(stats, source) MatamazomStats* stats = (source)
+#define STATS_RECORD_IN(stats, api, result, start) \
+	mtmStatsRecord(stats, api, result, start)
+//(atomic, snapshot reports count from other threads)
+#define STATS_COUNT(product, counter) \
+	__atomic_fetch_add(&(product)->stats->counter, 1, __ATOMIC_RELAXED)
+#else
+#define STATS_START(start)
+#define STATS_RECORD(matamazom, api, result, start)
+#define STATS_SOURCE(stats, source)
+#define STATS_RECORD_IN(stats, api, result, start)
+#define STATS_COUNT(product, counter)
+#endif
 
 /** Type for defining the product struct */
 typedef struct Product_t* Product;
 
+//memory counters of a warehouse, kept by its allocation paths
+typedef struct MtmMemory_t {
+	MtmMemoryCounter nodes;//nodes of the storage
+	MtmMemoryCounter products;//product structs
+	MtmMemoryCounter names;//interned names
+	MtmMemoryCounter user_data;//additional data of the products
+	MtmMemoryCounter order_headers;//order structs
+	MtmMemoryCounter order_lines;//nodes of the order products and their
+	                             //product copies
+	MtmMemoryCounter sales_velocity;//sales velocity rings
+	MtmMemoryCounter name_index;//pairs of the name index and its array
+	MtmMemoryCounter sales_history;//records of the history and its chunks
+	MtmMemoryCounter change_feed;//slots of the change feed ring
+	MtmGetDataSize dataSize;//size function of additional data, may be NULL
+} MtmMemory;
+
 //defining product
 struct Product_t {
-	char* product_name;//name
+	union {
+		char inline_name[INLINE_NAME_SIZE];//short name, copied with product
+		NameEntry interned_name;//long name, shared by the copies
+	} product_name;//name
+	bool is_name_inline;//which member of product_name is used
 	unsigned int product_id;//id
 	unsigned int amount_sold;
+	SalesVelocity velocity;//recent sales, shared by the copies, or NULL
+	double reserved;//amount held by orders, in reservation mode
+	MtmAmountWatcher watcher;//called when the amount drops below threshold
+	double watch_threshold;
+	void* watch_context;//passed as is to watcher
 	MatamazomAmountType measurement_type;//product measurement
 	MtmProductData additional_data;//additional info
     MtmCopyData copyData;//copy product data function
     MtmFreeData freeData;//free product data function
     MtmGetProductPrice prodPrice;//get product price function
-
+	const MtmAllocator* allocator;//allocator of the product and its name
+	MtmMemory* memory;//memory counters of the owning warehouse
+	bool is_order_line;//counted with the order lines, not the products
+	size_t data_size;//size of additional_data, as counted
+	int owners;//nodes holding the record: of the storage and its snapshots
+#ifdef MATAMAZOM_STATS
+	MatamazomStats* stats;//counters of the owning warehouse
+#endif
 };
 
 //defining matamazom warehouse struct
 struct Matamazom_t {
 	AmountSet products_storage;//amount set of products
 	List order_list;//list  of orders
+	NameTable names;//interned long product names
+	NameIndex name_index;//products by name, for name and prefix lookups
+	SalesHistory sales_history;//lines of the shipped orders
+	bool reservation_mode;//orders hold the stock of their lines
+	MtmAmountWatcher default_watcher;//watch of new products, may be NULL
+	double default_threshold;
+	void* default_context;
 	unsigned int num_orders;//number of orders
+	MtmAllocator allocator;//allocator for everything the warehouse owns
+	MtmMemory memory;//memory counters
+	ChangeFeed changes;//recorded changes, NULL while disabled
+	unsigned long change_seq;//last sequence number of a disabled feed
+	int velocity_intervals;//intervals of the velocity rings, 0 for none
+	unsigned long sales_tick;//current sales interval
+	int snapshots;//live snapshots, they may share the storage records
+#ifdef MATAMAZOM_STATS
+	MatamazomStats stats;//api and internal event counters
+#endif
+};
+
+//staged (product id, amount) pair of an order edit
+typedef struct OrderEditLine_t {
+	unsigned int product_id;
+	double amount;
+	int seq;//staging order, keeps same product lines in call order
+	Product product;//storage product, set while validating
+	double available;//unreserved stock of product, set while validating
+} OrderEditLine;
+
+//defining order edit
+struct MtmOrderEdit_t {
+	Matamazom matamazom;//warehouse of the order
+	unsigned int order_id;//edited order
+	OrderEditLine* lines;//staged lines
+	int size;
+	int capacity;
+};
+
+//products read by mtmImportProducts, as updates of the storage
+typedef struct ImportBuffer_t {
+	ASUpdate* updates;//element is the read product, amount its amount
+	int size;
+	int capacity;
+} ImportBuffer;
+
+//defining snapshot
+struct MtmSnapshot_t {
+	AmountSet products;//copy on write copy of the storage
+	Matamazom matamazom;//warehouse of the snapshot
+	const MtmAllocator* allocator;//allocator of the warehouse
+#ifdef MATAMAZOM_STATS
+	MatamazomStats* stats;//stats of the warehouse
+#endif
 };
 
 //defining static functions
 //for product
 static ASElement copyProduct(ASElement source_element);
+static ASElement copyOrderLine(ASElement source_element);
 static void freeProduct(ASElement element_to_free);
 static int compareProduct(ASElement element1, ASElement element2);
+static unsigned int getProductKey(ASElement element);
+static double getProductPrice(Product product, double amount);
+static const char* getProductName(Product product);
+static bool setProductName(Product product, NameTable names,
+                           const char* name);
+static bool isValidProductName(const char* name);
+static void countProductData(Product product);
+static Product createProduct(Matamazom matamazom, unsigned int id,
+        const char* name, MatamazomAmountType amountType,
+        MtmProductData customData, MtmCopyData copyData,
+        MtmFreeData freeData, MtmGetProductPrice prodPrice);
 
 //additional static funcs
 static bool inRange(double n, double high, double low);
@@ -64,65 +193,296 @@ static void changeOrderProductAmount(Order ret_order,Product ret_product,
 static bool checkInsufficientAmount(Matamazom matamazom,Order order);
 static void decreaseProductFromStorageByOrder(Matamazom matamazom,
                                               Order ret_order);
+static void removeOrder(Matamazom matamazom, const unsigned int orderId);
+//for reservations
+static MatamazomResult reserveOrderLine(Matamazom matamazom, Order order,
+                                        Product product, double available,
+                                        double amount);
+static void releaseOrderReservations(Matamazom matamazom, Order order);
+static MatamazomResult reserveAllOrders(Matamazom matamazom);
+//for watches
+static void notifyWatch(Product product, double old_amount,
+                        double new_amount);
+static void setProductWatch(Product product, double threshold,
+                            MtmAmountWatcher watcher, void* context);
 //for printing
 static void printProductsInAmountSet(AmountSet product_storage, bool flag ,
         FILE* output);
 //for price calculation
 static double getOrderPrice(Order order);
 static double getOrdersTotalPrice(Matamazom matamazom);
-static Product getBestProfitableProduct(Matamazom matamazom);
+static Product getBestProfitableProduct(AmountSet products);
+static void printBestSellingProduct(AmountSet products, FILE* output);
+static MatamazomResult printFilteredProducts(AmountSet products,
+        bool read_only, MtmFilterProduct customFilter, FILE* output);
+static Product walkFirstProduct(AmountSet products, ASCursor cursor,
+                                Product key);
+static Product walkNextProduct(AmountSet products, ASCursor cursor,
+                               unsigned int id);
+static double walkAmount(AmountSet products, ASCursor cursor);
+//for structured queries
+static MatamazomResult queryProducts(AmountSet products, bool read_only,
+        const unsigned int* afterId, MtmFilterProduct customFilter,
+        bool flag, int limit, MtmProductInfo* items, int* outCount);
+//for snapshots
+static MatamazomResult detachStorage(Matamazom matamazom);
+static Product detachProduct(Matamazom matamazom, unsigned int id);
+static MatamazomResult detachOrderProducts(Matamazom matamazom, Order order);
+static MatamazomResult detachAllProducts(Matamazom matamazom);
+//for the change feed
+static void recordChange(Matamazom matamazom, MtmChangeType type,
+                         unsigned int product_id, unsigned int order_id,
+                         double amount);
+static void recordOrderLine(Matamazom matamazom, Order order,
+                            Product product);
+static void publishChanges(Matamazom matamazom);
+//for order edits
+static int compareOrderEditLines(const void* line1, const void* line2);
+static MatamazomResult validateOrderEdit(MtmOrderEdit edit);
+static int buildOrderEditUpdates(MtmOrderEdit edit, Order order,
+                                 ASUpdate* updates, double* deltas);
+static MatamazomResult checkOrderEditReservations(MtmOrderEdit edit,
+        const ASUpdate* updates, const double* deltas, int count);
+//for order consolidation
+static int compareOrderIds(const void* id1, const void* id2);
+static MatamazomResult mergeOrderProducts(Matamazom matamazom, Order target,
+                                          Order* sources, int count);
+static void retireOrders(Matamazom matamazom, const unsigned int* ids,
+                         int count, Order* heads, struct Order_t* moved);
+//for bulk import
+static int compareImportUpdates(const void* update1, const void* update2);
+static MatamazomResult readImportedProducts(Matamazom matamazom,
+        MtmProductReader reader, void* context, ImportBuffer* buffer);
+static MatamazomResult checkImportedIds(Matamazom matamazom,
+                                        ImportBuffer* buffer);
+static MatamazomResult storeImportedProducts(Matamazom matamazom,
+                                             ImportBuffer* buffer);
+static bool isSmallImport(Matamazom matamazom, ImportBuffer* buffer);
+static MatamazomResult storeFewImportedProducts(Matamazom matamazom,
+                                                ImportBuffer* buffer);
+//implementation of the entry points, wrapped by the instrumentation
+static MatamazomResult newProduct(Matamazom matamazom, const unsigned int id,
+        const char *name, const double amount,
+        const MatamazomAmountType amountType, const MtmProductData customData,
+        MtmCopyData copyData, MtmFreeData freeData,
+        MtmGetProductPrice prodPrice);
+static MatamazomResult changeProductAmount(Matamazom matamazom,
+        const unsigned int id, const double amount);
+static MatamazomResult clearProduct(Matamazom matamazom,
+                                    const unsigned int id);
+static unsigned int createNewOrder(Matamazom matamazom);
+static MatamazomResult changeProductAmountInOrder(Matamazom matamazom,
+        const unsigned int orderId, const unsigned int productId,
+        const double amount);
+static MatamazomResult shipOrder(Matamazom matamazom,
+                                 const unsigned int orderId);
+static MatamazomResult cancelOrder(Matamazom matamazom,
+                                   const unsigned int orderId);
+static MatamazomResult printInventory(Matamazom matamazom, FILE* output);
+static MatamazomResult printOrder(Matamazom matamazom,
+                                  const unsigned int orderId, FILE* output);
+static MatamazomResult printBestSelling(Matamazom matamazom, FILE* output);
+static MatamazomResult printFiltered(Matamazom matamazom,
+        MtmFilterProduct customFilter, FILE* output);
+static MatamazomResult orderEditBegin(Matamazom matamazom,
+                                      const unsigned int orderId,
+                                      MtmOrderEdit* edit);
+static MatamazomResult orderEditStage(MtmOrderEdit edit,
+                                      const unsigned int productId,
+                                      const double amount);
+static MatamazomResult orderEditCommit(MtmOrderEdit edit);
+static void orderEditAbort(MtmOrderEdit edit);
+static MatamazomResult mergeOrders(Matamazom matamazom,
+                                   const unsigned int targetId,
+                                   const unsigned int* sourceIds,
+                                   const int count);
+static MatamazomResult printInventoryRange(Matamazom matamazom,
+                                           const unsigned int lowId,
+                                           const unsigned int highId,
+                                           FILE* output);
+static MatamazomResult findProductsByPrefix(Matamazom matamazom,
+                                            const char* prefix,
+                                            MtmProductVisitor visitor,
+                                            void* context);
+static MatamazomResult findProductsByName(Matamazom matamazom, const char* name,
+                                          MtmProductVisitor visitor,
+                                          void* context);
+static MatamazomResult getSalesRevenue(Matamazom matamazom,
+                                       const unsigned int lastShipments,
+                                       const unsigned int lowId,
+                                       const unsigned int highId,
+                                       double* outRevenue);
+static MatamazomResult importProducts(Matamazom matamazom,
+                                      MtmProductReader reader, void* context);
+static MatamazomResult setReservationMode(Matamazom matamazom, bool enabled);
+static MatamazomResult getAvailableAmount(Matamazom matamazom,
+                                          const unsigned int productId,
+                                          double* outAmount);
+static MatamazomResult watchAmountBelow(Matamazom matamazom,
+                                        const unsigned int productId,
+                                        const double threshold,
+                                        MtmAmountWatcher watcher,
+                                        void* context);
+static MatamazomResult watchAllAmountsBelow(Matamazom matamazom,
+                                            const double threshold,
+                                            MtmAmountWatcher watcher,
+                                            void* context);
+static MatamazomResult setDataSizeFunction(Matamazom matamazom,
+                                           MtmGetDataSize dataSize);
+static MatamazomResult getMemoryUsage(Matamazom matamazom,
+                                      MtmMemoryUsage* usage);
+static MatamazomResult prepareShipOrder(Matamazom matamazom,
+                                        const unsigned int orderId);
+static MatamazomResult getBestSelling(Matamazom matamazom, unsigned int* outId,
+                                      double* outIncome, const char** outName);
+static MtmSnapshot snapshotCreate(Matamazom matamazom);
+static void snapshotDestroy(MtmSnapshot snapshot);
+static MatamazomResult snapshotGetProductAmount(MtmSnapshot snapshot,
+                                                const unsigned int productId,
+                                                double* outAmount);
+static MatamazomResult snapshotPrintInventory(MtmSnapshot snapshot,
+                                              FILE* output);
+static MatamazomResult snapshotPrintBestSelling(MtmSnapshot snapshot,
+                                                FILE* output);
+static MatamazomResult snapshotPrintFiltered(MtmSnapshot snapshot,
+                                             MtmFilterProduct customFilter,
+                                             FILE* output);
+static MatamazomResult enableChangeFeed(Matamazom matamazom, int capacity,
+                                        MtmChangeListener listener, int batch,
+                                        void* context);
+static MatamazomResult pollChanges(Matamazom matamazom,
+                                   unsigned long afterSeq, MtmChange* changes,
+                                   int max, int* outCount);
+static MatamazomResult flushChanges(Matamazom matamazom);
+static MatamazomResult queryInventory(Matamazom matamazom,
+                                      const unsigned int* afterId, int limit,
+                                      MtmProductInfo* items, int* outCount);
+static MatamazomResult queryOrder(Matamazom matamazom,
+                                  const unsigned int orderId,
+                                  const unsigned int* afterId, int limit,
+                                  MtmProductInfo* items, int* outCount);
+static MatamazomResult queryFiltered(Matamazom matamazom,
+                                     MtmFilterProduct customFilter,
+                                     const unsigned int* afterId, int limit,
+                                     MtmProductInfo* items, int* outCount);
+static MatamazomResult snapshotQueryInventory(MtmSnapshot snapshot,
+                                              const unsigned int* afterId,
+                                              int limit,
+                                              MtmProductInfo* items,
+                                              int* outCount);
+static MatamazomResult setSalesVelocityWindow(Matamazom matamazom,
+                                              int intervals);
+static MatamazomResult tickSalesInterval(Matamazom matamazom);
+static MatamazomResult getSalesVelocity(Matamazom matamazom,
+                                        const unsigned int productId,
+                                        double* outAverage);
+static MatamazomResult reserveCapacity(Matamazom matamazom,
+                                       int expectedProducts,
+                                       int expectedShippedLines);
+static MatamazomResult reserveOrderLines(Matamazom matamazom,
+                                         const unsigned int orderId,
+                                         int expectedLines);
 
 
 /*
-copyProduct - returns a copy of source_element as product
+countProductRecord - counts the allocation or release of a product record.
+records of order lines add to the bytes of the lines, not to their count
 INPUT:
-	@param source_element - product to copy
+	@param product - the product
+	@param allocated - true for an allocation, false for a release
+*/
+static void countProductRecord(Product product, bool allocated) {
+	MtmMemoryCounter* counter = product->is_order_line ?
+	                            &product->memory->order_lines :
+	                            &product->memory->products;
+	size_t count = product->is_order_line ? 0 : 1;
+	if (allocated) {
+		mtmMemoryAdd(counter, count, sizeof(*product));
+	} else {
+		mtmMemorySub(counter, count, sizeof(*product));
+	}
+}
+
+/*
+copyProductRecord - returns a copy of a product
+INPUT:
+	@param source_product - product to copy
+	@param is_order_line - true if the copy is a line of an order
 OUTPUT:
 	@param dest_product - copied product, NULL if failed
 */
-static ASElement copyProduct(ASElement source_element) {
-	
+static Product copyProductRecord(Product source_product, bool is_order_line) {
+
 	//creates new product and checks if valid
-	Product dest_product = malloc(sizeof(*dest_product));
+	Product dest_product = mtmAllocate(source_product->allocator,
+	                                   sizeof(*dest_product));
 	if (dest_product == NULL)
 	{
 		return NULL;
 	}
-
-	//convert element to product
-	Product source_product = (Product)source_element;
 	
 	//regular copy
+	dest_product->allocator = source_product->allocator;
+	dest_product->memory = source_product->memory;
+	dest_product->is_order_line = is_order_line;
+	dest_product->owners = 1;
+	countProductRecord(dest_product, true);
 	dest_product->product_id = source_product->product_id;
 	dest_product->measurement_type = source_product->measurement_type;
 	dest_product->copyData = source_product->copyData;
 	dest_product->freeData = source_product->freeData;
 	dest_product->prodPrice = source_product->prodPrice;
 	dest_product->amount_sold = source_product->amount_sold;
+	dest_product->velocity = salesVelocityRetain(source_product->velocity);
+	dest_product->reserved = source_product->reserved;
+	setProductWatch(dest_product, source_product->watch_threshold,
+	                source_product->watcher, source_product->watch_context);
+#ifdef MATAMAZOM_STATS
+	dest_product->stats = source_product->stats;
+#endif
+
+	//names arent allocated, short ones are copied and long ones shared
+	dest_product->product_name = source_product->product_name;
+	dest_product->is_name_inline = source_product->is_name_inline;
+	if (!dest_product->is_name_inline) {
+		nameEntryRetain(dest_product->product_name.interned_name);
+	}
 	
 	//deep copy
+	STATS_COUNT(source_product, copy_data_calls);
 	dest_product->additional_data = 
 		source_product->copyData(source_product->additional_data);
-	
-	//creates new name and checks if valid
-	dest_product->product_name = 
-		malloc(strlen(source_product->product_name)+1);
-	if (dest_product->product_name == NULL)
-	{
-		//if out of memory, destroys dest product and returns NULL
-		dest_product->freeData(dest_product->additional_data);
-		free(dest_product);
-		return NULL;
-	}
-
-	else {//allocation valid - copies string
-		strcpy(dest_product->product_name, source_product->product_name);
-	}
+	countProductData(dest_product);
 
 	//passed all copies, returns dest product
 	return dest_product;
 }
 
+/*
+copyProduct - copy function of the storage, the record is shared instead
+of copied: the copies of the storage nodes for snapshots dont copy the
+products, and detachProduct copies a shared record before it changes
+INPUT:
+	@param source_element - product to copy
+OUTPUT:
+	@param dest_product - the product, with one more owner
+*/
+static ASElement copyProduct(ASElement source_element) {
+	((Product)source_element)->owners++;
+	return source_element;
+}
+
+/*
+copyOrderLine - returns a copy of source_element as product of an order
+INPUT:
+	@param source_element - product to copy
+OUTPUT:
+	@param dest_product - copied product, NULL if failed
+*/
+static ASElement copyOrderLine(ASElement source_element) {
+	return copyProductRecord((Product)source_element, true);
+}
+
 /*
 freeProduct - frees the given element as product
 INPUT:
@@ -136,12 +496,21 @@ static void freeProduct(ASElement element_to_free) {
 		
 		//converts element to product
 		product_to_free = (Product)element_to_free;
+		if (--product_to_free->owners > 0) {//shared storage record
+			return;
+		}
 		//frees allocated data in product
 		product_to_free->freeData(product_to_free->additional_data);
-		free(product_to_free->product_name);
+		if (!product_to_free->is_name_inline) {
+			nameEntryRelease(product_to_free->product_name.interned_name);
+		}
+		salesVelocityRelease(product_to_free->velocity);
 		
 		//frees the allocated product
-		free(product_to_free);
+		mtmMemorySub(&product_to_free->memory->user_data, 1,
+		             product_to_free->data_size);
+		countProductRecord(product_to_free, false);
+		mtmRelease(product_to_free->allocator, product_to_free);
 	}
 }
 
@@ -151,7 +520,7 @@ INPUT:
 	@param element1 - referance element
 	@param element2 - addtional element
 OUTPUT:
-	returns the sub result of their id's.
+	returns the compare result of their id's.
 	if output < 0 -> element1 < element2
 	if output > 0 -> element1 > element2
 	if output = 0 -> element1 = element2
@@ -162,7 +531,154 @@ static int compareProduct(ASElement element1, ASElement element2) {
 	Product ref_product = (Product)element1;
 	Product non_ref_product = (Product)element2;
 
-	return ref_product->product_id - non_ref_product->product_id;//seb result
+	//(a subtraction of unsigned ids overflows for far apart ids)
+	return (ref_product->product_id > non_ref_product->product_id) -
+	       (ref_product->product_id < non_ref_product->product_id);
+}
+
+/*
+getProductKey - returns the key of an element as product, its id
+INPUT:
+	@param element - the product
+OUTPUT:
+	the id of the product
+*/
+static unsigned int getProductKey(ASElement element) {
+	return ((Product)element)->product_id;
+}
+
+/*
+getProductPrice - returns the price of an amount of the given product
+INPUT:
+	@param product - the product
+	@param amount - amount to price
+OUTPUT:
+	the price returned by the product prodPrice function
+*/
+static double getProductPrice(Product product, double amount) {
+	STATS_COUNT(product, price_calls);
+	return product->prodPrice(product->additional_data, amount);
+}
+
+/*
+getProductName - returns the name of the given product
+INPUT:
+	@param product - the product
+OUTPUT:
+	the name, owned by the product
+*/
+static const char* getProductName(Product product) {
+	if (product->is_name_inline) {
+		return product->product_name.inline_name;
+	}
+	return nameEntryGet(product->product_name.interned_name);
+}
+
+/*
+setProductName - sets the name of a new product. short names are kept
+inline in the product, long names are interned in the warehouse table
+INPUT:
+	@param product - the product
+	@param names - name table of the warehouse
+	@param name - the name
+OUTPUT:
+	false if out of memory, else true
+*/
+static bool setProductName(Product product, NameTable names,
+                           const char* name) {
+
+	size_t length = strlen(name);
+	product->is_name_inline = (length < INLINE_NAME_SIZE);
+	if (product->is_name_inline) {
+		memcpy(product->product_name.inline_name, name, length + 1);
+		return true;
+	}
+	product->product_name.interned_name = nameTableIntern(names, name);
+	return product->product_name.interned_name != NULL;
+}
+
+/*
+isValidProductName - checks that a name starts with a letter or a digit
+INPUT:
+	@param name - the name
+OUTPUT:
+	true if valid, false if not or name is NULL
+*/
+static bool isValidProductName(const char* name) {
+	return name != NULL && (inRange(name[0], SMALL_Z, SMALL_A) ||
+		inRange(name[0], CAPITAL_Z, CAPITAL_A) ||
+		inRange(name[0], HIGHEST_DIGIT, SMALLEST_DIGIT));
+}
+
+/*
+countProductData - counts the memory of the additional data of a product
+that was just copied, with the size function of the warehouse
+INPUT:
+	@param product - the product
+*/
+static void countProductData(Product product) {
+	MtmGetDataSize dataSize = product->memory->dataSize;
+	product->data_size = (dataSize != NULL &&
+	                      product->additional_data != NULL) ?
+	                     dataSize(product->additional_data) : 0;
+	mtmMemoryAdd(&product->memory->user_data, 1, product->data_size);
+}
+
+/*
+createProduct - creates a product of the warehouse from validated args,
+customData is copied with copyData
+INPUT:
+	@param matamazom - the warehouse
+	@param id, name, amountType, customData, copyData, freeData,
+	       prodPrice - as in mtmNewProduct
+OUTPUT:
+	the product (freed with freeProduct), NULL if out of memory
+*/
+static Product createProduct(Matamazom matamazom, unsigned int id,
+        const char* name, MatamazomAmountType amountType,
+        MtmProductData customData, MtmCopyData copyData,
+        MtmFreeData freeData, MtmGetProductPrice prodPrice) {
+
+    Product new_product = mtmAllocate(&matamazom->allocator,
+                                      sizeof(*new_product));
+    if(new_product == NULL){
+        return NULL;
+    }
+    new_product->allocator = &matamazom->allocator;
+	new_product->memory = &matamazom->memory;
+	new_product->is_order_line = false;
+	new_product->owners = 1;
+    new_product->product_id = id;
+    new_product->freeData = freeData;
+    new_product->copyData = copyData;
+    new_product->measurement_type = amountType;
+	new_product->prodPrice = prodPrice;
+	new_product->amount_sold=0;
+	new_product->velocity = NULL;
+	new_product->reserved = 0;
+	setProductWatch(new_product, matamazom->default_threshold,
+	                matamazom->default_watcher, matamazom->default_context);
+#ifdef MATAMAZOM_STATS
+	new_product->stats = &matamazom->stats;
+#endif
+	if (!setProductName(new_product, matamazom->names, name)) {
+		mtmRelease(new_product->allocator, new_product);
+		return NULL;
+	}
+	mtmMemoryAdd(&matamazom->memory.products, 1, sizeof(*new_product));
+	STATS_COUNT(new_product, copy_data_calls);
+	new_product->additional_data = new_product->copyData(customData);
+	countProductData(new_product);
+	if (matamazom->velocity_intervals > 0) {
+		new_product->velocity = salesVelocityCreate(
+			matamazom->velocity_intervals, matamazom->sales_tick,
+			&matamazom->allocator, &matamazom->memory.sales_velocity);
+		if (new_product->velocity == NULL) {
+			freeProduct(new_product);
+			return NULL;
+		}
+	}
+	return new_product;
 }
 
 
@@ -228,12 +744,14 @@ OUTPUT:
 */
 static Product searchProductById(AmountSet products_storage,
 	                             unsigned int product_id){
-	//using macro to search inside amount set
-	//note that current_product is set to be Product obj
-	AS_FOREACH(Product,currrent_product,products_storage){
-        if(currrent_product->product_id == product_id){
-            return currrent_product;
-        }
+	//the storage is sorted by id, so the search stops at the first
+	//product that isnt smaller than the key
+	//(compareProduct reads only the id of the key)
+	struct Product_t key_product;
+	key_product.product_id = product_id;
+	Product found_product = asGetLowerBound(products_storage, &key_product);
+    if(found_product != NULL && found_product->product_id == product_id){
+        return found_product;
     }
     return NULL;
 }
@@ -305,15 +823,11 @@ INPUT:
 NOTE: we relay on the fact that id,asDelete() are valid 
 */
 static void clearProductFromOrder(Order order, const unsigned int id){
-	//using macro to search inside order products amount
-	//note that current_product is set to be product obj
-	AS_FOREACH(Product, current_product, order->order_products) {
-        if(current_product->product_id==id){
-            //current_product->freeData(current_product->additional_data);
-            asDelete(order->order_products,
-				            current_product);
-        }
-    }
+	//deletes by key instead of deleting inside an AS_FOREACH walk
+	//(compareProduct reads only the id of the key)
+	struct Product_t key_product;
+	key_product.product_id = id;
+	asDelete(order->order_products, &key_product);
 }
 
 /**
@@ -349,13 +863,307 @@ static void decreaseProductFromStorageByOrder(Matamazom matamazom,
     double order_amount=0;
     AS_FOREACH(Product,current_product,ret_order->order_products){
         asGetAmount(ret_order->order_products,current_product,&order_amount);
-		searchProductById(matamazom->products_storage,
-		        current_product->product_id)->amount_sold += order_amount;
-		mtmChangeProductAmount(matamazom,current_product->product_id,
+		Product storage_product = searchProductById(
+			matamazom->products_storage, current_product->product_id);
+		storage_product->amount_sold += order_amount;
+		if (storage_product->velocity != NULL) {
+			salesVelocityAdd(storage_product->velocity,
+			                 matamazom->sales_tick, order_amount);
+		}
+		if (matamazom->reservation_mode) {//commits the reservation
+			storage_product->reserved -= order_amount;
+		}
+		//records the line, room was reserved by shipOrder
+		salesHistoryAppend(matamazom->sales_history, ret_order->order_id,
+		                   current_product->product_id, order_amount,
+		                   getProductPrice(storage_product, order_amount));
+		changeProductAmount(matamazom,current_product->product_id,
                                (NEGETIVE(order_amount)));
     }
+	salesHistoryEndShipment(matamazom->sales_history);
+}
+
+/*
+removeOrder - removes an order from the order list
+INPUT:
+	@param matamazom - a warehouse
+	@param orderId - id of the order
+*/
+static void removeOrder(Matamazom matamazom, const unsigned int orderId) {
+    LIST_FOREACH(Order,current_order,matamazom->order_list){
+        if(current_order->order_id==orderId){
+			listRemoveCurrent(matamazom->order_list);
+        }
+    }
+}
+
+/*
+reserveOrderLine - updates the reservation of a product for a change of
+its amount in an order, before the change is made.
+the change is the same as in changeOrderProductAmount.
+INPUT:
+	@param matamazom - a warehouse in reservation mode
+	@param order - the order
+	@param product - the storage product
+	@param available - unreserved stock of product
+	@param amount - amount added to the order line, not 0
+OUTPUT:
+	MATAMAZOM_INSUFFICIENT_AMOUNT - if amount is more than available
+	MATAMAZOM_SUCCESS - otherwise, and the reservation is updated
+*/
+static MatamazomResult reserveOrderLine(Matamazom matamazom, Order order,
+                                        Product product, double available,
+                                        double amount) {
+
+	assert(matamazom->reservation_mode);
+	if (amount > 0) {
+		if (amount > available) {
+			return MATAMAZOM_INSUFFICIENT_AMOUNT;
+		}
+		product->reserved += amount;
+		return MATAMAZOM_SUCCESS;
+	}
 
+	//a line that would drop below 0 is removed, releasing all of it
+	double order_amount = 0;
+	if (asGetAmount(order->order_products, product, &order_amount) ==
+	    AS_SUCCESS) {
+		product->reserved -= (order_amount + amount < 0) ? order_amount :
+		                                                   NEGETIVE(amount);
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+/*
+releaseOrderReservations - releases the stock held by an order
+INPUT:
+	@param matamazom - a warehouse in reservation mode
+	@param order - the order
+*/
+static void releaseOrderReservations(Matamazom matamazom, Order order) {
+
+	double order_amount = 0;
+	AS_FOREACH(Product, order_product, order->order_products) {
+		asGetCurrentAmount(order->order_products, &order_amount);
+		searchProductById(matamazom->products_storage,
+		                  order_product->product_id)->reserved -= order_amount;
+	}
+}
+
+/*
+reserveAllOrders - computes the reservations of the existing orders
+INPUT:
+	@param matamazom - a warehouse
+OUTPUT:
+	MATAMAZOM_INSUFFICIENT_AMOUNT - if the orders need more than the stock
+	of a product, no reservation is kept then
+	MATAMAZOM_SUCCESS - otherwise
+*/
+static MatamazomResult reserveAllOrders(Matamazom matamazom) {
+
+	double order_amount = 0;
+	LIST_FOREACH(Order, cur_order, matamazom->order_list) {
+		AS_FOREACH(Product, order_product, cur_order->order_products) {
+			asGetCurrentAmount(cur_order->order_products, &order_amount);
+			searchProductById(matamazom->products_storage,
+			        order_product->product_id)->reserved += order_amount;
+		}
+	}
+
+	MatamazomResult result = MATAMAZOM_SUCCESS;
+	double storage_amount = 0;
+	AS_FOREACH(Product, cur_product, matamazom->products_storage) {
+		asGetCurrentAmount(matamazom->products_storage, &storage_amount);
+		if (cur_product->reserved > storage_amount) {
+			result = MATAMAZOM_INSUFFICIENT_AMOUNT;
+		}
+	}
+	if (result != MATAMAZOM_SUCCESS) {
+		AS_FOREACH(Product, cur_product, matamazom->products_storage) {
+			cur_product->reserved = 0;
+		}
+	}
+	return result;
+}
+
+/*
+notifyWatch - calls the watcher of a product if its amount just dropped
+below the threshold, O(1)
+INPUT:
+	@param product - the product
+	@param old_amount - amount before the change
+	@param new_amount - amount after the change
+*/
+static void notifyWatch(Product product, double old_amount,
+                        double new_amount) {
+	if (product->watcher != NULL && new_amount < product->watch_threshold &&
+	    old_amount >= product->watch_threshold) {
+		product->watcher(product->product_id, new_amount,
+		                 product->watch_threshold, product->watch_context);
+	}
+}
+
+/*
+setProductWatch - sets the watch of a product
+INPUT:
+	@param product - the product
+	@param threshold - the threshold
+	@param watcher - the watcher, NULL for no watch
+	@param context - passed as is to watcher
+*/
+static void setProductWatch(Product product, double threshold,
+                            MtmAmountWatcher watcher, void* context) {
+	product->watcher = watcher;
+	product->watch_threshold = threshold;
+	product->watch_context = context;
+}
+/*
+detachStorage - makes the nodes of the storage its own, so changing them
+cant fail halfway. O(1) unless a snapshot still shares them, then they
+are copied, without copying the records (see copyProduct)
+INPUT:
+	@param matamazom - a warehouse
+OUTPUT:
+	MATAMAZOM_OUT_OF_MEMORY if copying the nodes failed, else
+	MATAMAZOM_SUCCESS
+*/
+static MatamazomResult detachStorage(Matamazom matamazom) {
+	return (asUnshare(matamazom->products_storage) == AS_SUCCESS) ?
+	       MATAMAZOM_SUCCESS : MATAMAZOM_OUT_OF_MEMORY;
+}
+
+/*
+detachProduct - makes the record of a storage product its own before it
+is changed in place (sold amounts, reservations, watches), so snapshots
+dont see the change. only a record a snapshot still shares is copied.
+detaching doesnt change anything visible, so a failure halfway through
+detaching many products needs no undo. leaves the internal iterator of
+the storage on the product
+INPUT:
+	@param matamazom - a warehouse
+	@param id - id of an existing product
+OUTPUT:
+	the record to change, NULL if copying failed
+*/
+static Product detachProduct(Matamazom matamazom, unsigned int id) {
+
+	if (detachStorage(matamazom) != MATAMAZOM_SUCCESS) {
+		return NULL;
+	}
+	Product product = searchProductById(matamazom->products_storage, id);
+	assert(product != NULL);
+	if (product->owners == 1) {
+		return product;
+	}
+	Product copy = copyProductRecord(product, false);
+	if (copy == NULL) {
+		return NULL;
+	}
+	asReplaceCurrent(matamazom->products_storage, copy);
+	return copy;
+}
+
+/*
+detachOrderProducts - detaches the storage records of the products of an
+order, before shipping or releasing it. O(1) without live snapshots
+INPUT:
+	@param matamazom - a warehouse
+	@param order - the order
+OUTPUT:
+	MATAMAZOM_OUT_OF_MEMORY if copying failed, else MATAMAZOM_SUCCESS
+*/
+static MatamazomResult detachOrderProducts(Matamazom matamazom, Order order) {
+
+	if (matamazom->snapshots == 0) {//then no record is shared
+		return detachStorage(matamazom);
+	}
+	AS_FOREACH(Product, order_product, order->order_products) {
+		if (detachProduct(matamazom, order_product->product_id) == NULL) {
+			return MATAMAZOM_OUT_OF_MEMORY;
+		}
+	}
+	return detachStorage(matamazom);
+}
+
+/*
+detachAllProducts - detaches every storage record, before all of them
+change. O(n), and O(1) without live snapshots
+INPUT:
+	@param matamazom - a warehouse
+OUTPUT:
+	MATAMAZOM_OUT_OF_MEMORY if copying failed, else MATAMAZOM_SUCCESS
+*/
+static MatamazomResult detachAllProducts(Matamazom matamazom) {
+
+	if (detachStorage(matamazom) != MATAMAZOM_SUCCESS) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	if (matamazom->snapshots == 0) {
+		return MATAMAZOM_SUCCESS;
+	}
+	AmountSet storage = matamazom->products_storage;
+	AS_FOREACH(Product, cur_product, storage) {
+		if (cur_product->owners > 1) {
+			Product copy = copyProductRecord(cur_product, false);
+			if (copy == NULL) {
+				return MATAMAZOM_OUT_OF_MEMORY;
+			}
+			asReplaceCurrent(storage, copy);
+		}
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+/*
+recordChange - appends a change to the change feed, if it is enabled, O(1)
+INPUT:
+	@param matamazom - a warehouse
+	@param type - kind of change
+	@param product_id - product of the change, 0 if none
+	@param order_id - order of the change, 0 if none
+	@param amount - new amount, 0 if none
+*/
+static void recordChange(Matamazom matamazom, MtmChangeType type,
+                         unsigned int product_id, unsigned int order_id,
+                         double amount) {
+	if (matamazom->changes != NULL) {
+		changeFeedAppend(matamazom->changes, type, product_id, order_id,
+		                 amount);
+	}
+}
+
+/*
+recordOrderLine - records the amount a product has in an order now, 0 if
+the order doesnt have it
+INPUT:
+	@param matamazom - a warehouse
+	@param order - the order
+	@param product - the product, only its id is read
+*/
+static void recordOrderLine(Matamazom matamazom, Order order,
+                            Product product) {
+	if (matamazom->changes == NULL) {
+		return;
+	}
+	double order_amount = 0;
+	asGetAmount(order->order_products, product, &order_amount);
+	recordChange(matamazom, MTM_CHANGE_ORDER_LINE_CHANGED,
+	             product->product_id, order->order_id, order_amount);
+}
+
+/*
+publishChanges - delivers the recorded changes to the feed listener once
+there is a batch of them. called at the end of the entry points, so the
+listener sees the warehouse after the changes
+INPUT:
+	@param matamazom - a warehouse, may be NULL
+*/
+static void publishChanges(Matamazom matamazom) {
+	if (matamazom != NULL && matamazom->changes != NULL) {
+		changeFeedPublish(matamazom->changes, false);
+	}
 }
+
 /*
 printProductsInAmountSet - prints all products in given amount set
 that contains only products
@@ -380,10 +1188,9 @@ static void printProductsInAmountSet(AmountSet product_storage, bool flag,
         asGetAmount(product_storage, cur_product,&cur_amount);
         //prints details
 		amount_to_price = (flag == true) ? cur_amount : SINGLE;
-        mtmPrintProductDetails(cur_product->product_name,
+        mtmPrintProductDetails(getProductName(cur_product),
                 cur_product->product_id, cur_amount,
-                cur_product->prodPrice(cur_product->additional_data,
-                        amount_to_price),output);
+                getProductPrice(cur_product, amount_to_price),output);
     }
 }
 /*
@@ -401,8 +1208,7 @@ static double getOrderPrice(Order order) {
     double price = 0;
     AS_FOREACH(Product, cur_product, order->order_products) {
         asGetAmount(order->order_products, cur_product, &cur_amount);
-        price += cur_product->prodPrice(cur_product->additional_data,
-                                        cur_amount);
+        price += getProductPrice(cur_product, cur_amount);
     }
     return price;
 }
@@ -424,22 +1230,22 @@ static double getOrdersTotalPrice(Matamazom matamazom) {
 /*
 getBestSellingProduct - gets the product who has the highest amount sold value
 INPUT:
-	@param matamazom - mighty matamazom
+	@param products - the storage of mighty matamazom, or a snapshot of it
 OUTPUT:
 	best selling product (when 2 same -choses the lower id porduct)
 	NULL if storage empty/no sells
 */
-static Product getBestProfitableProduct(Matamazom matamazom) {
-    if (matamazom->products_storage == NULL)
+static Product getBestProfitableProduct(AmountSet products) {
+    if (products == NULL)
     {
         return NULL;
     }
     double max_profit = 0;
     double product_profit = 0;
 	int max_profit_id = DEF_PROFIT;
-    AS_FOREACH(Product, cur_product, matamazom->products_storage) {
-        product_profit = cur_product->prodPrice(cur_product->additional_data,
-                                                cur_product->amount_sold);
+    AS_FOREACH(Product, cur_product, products) {
+        product_profit = getProductPrice(cur_product,
+                                         cur_product->amount_sold);
 		
 		if (product_profit > max_profit || (product_profit = max_profit
 		        && product_profit > 0 &&
@@ -449,36 +1255,317 @@ static Product getBestProfitableProduct(Matamazom matamazom) {
 		}
     }
     return (max_profit_id == DEF_PROFIT) ? NULL :
-		          searchProductById(matamazom->products_storage, max_profit_id);
+		          searchProductById(products, max_profit_id);
 }
 
-Matamazom matamazomCreate(){
-	
-	//allocates matamzom and checks if valid
-	Matamazom allocated_matamazom = malloc(sizeof(*allocated_matamazom));
-    if (allocated_matamazom == NULL){//if fail - frees memory
-        return NULL;
-    }
-
-	//allocates amount set for products and checks if valid
-	allocated_matamazom->products_storage=asCreate(copyProduct, freeProduct,
-											       compareProduct);
-    if (allocated_matamazom->products_storage == NULL){//if fail - frees memory
-        free(allocated_matamazom);
-        return NULL;
-    }
-
-	//allocates list for products and checks if valid
-	allocated_matamazom->order_list =listCreate(copyOrder,freeOrder);
-    if(allocated_matamazom->order_list==NULL){//if fail - frees memory
-        asDestroy(allocated_matamazom->products_storage);
-        free(allocated_matamazom);
-        return NULL;
-    }
-
-	allocated_matamazom->num_orders = 0;
-	return allocated_matamazom;
+/*
+printBestSellingProduct - prints the best selling report of products
+INPUT:
+	@param products - the storage, or a snapshot of it
+	@param output - open stream to print into
+*/
+static void printBestSellingProduct(AmountSet products, FILE* output) {
 
+	//print header
+	fprintf(output,"Best Selling Product:\n");
+    Product best_seller = getBestProfitableProduct(products);
+    
+	if (best_seller != NULL)
+	{
+		mtmPrintIncomeLine(getProductName(best_seller), best_seller->product_id,
+			getProductPrice(best_seller, best_seller->amount_sold)
+			,output);
+	}
+	else
+	{
+		fprintf(output,"none\n");
+	}
+}
+
+/*
+walkFirstProduct - starts a walk of the products of a storage, with a
+cursor, or with the internal iterator of the storage if cursor is NULL
+(read only storages of snapshots, walking them doesnt allocate)
+INPUT:
+	@param products - the storage
+	@param cursor - cursor of the storage, or NULL
+	@param key - the walk starts at the first product whose id isnt smaller
+	             than the id of key, NULL to start at the first product
+OUTPUT:
+	the first product of the walk, NULL if there is none
+*/
+static Product walkFirstProduct(AmountSet products, ASCursor cursor,
+                                Product key) {
+	if (cursor != NULL) {
+		return (key != NULL) ? asCursorSeek(cursor, key) :
+		                       asCursorGet(cursor);
+	}
+	return (key != NULL) ? asGetLowerBound(products, key) :
+	                       asGetFirst(products);
+}
+
+/*
+walkNextProduct - advances a walk started by walkFirstProduct past the
+current product. a cursor whose product was cleared (by a filter called
+on it) was already moved to the next product, and stays there
+INPUT:
+	@param products - the storage
+	@param cursor - cursor of the walk, or NULL
+	@param id - id of the current product
+OUTPUT:
+	the next product, NULL at the end
+*/
+static Product walkNextProduct(AmountSet products, ASCursor cursor,
+                               unsigned int id) {
+	if (cursor == NULL) {
+		return asGetNext(products);
+	}
+	Product cur_product = asCursorGet(cursor);
+	return (cur_product != NULL && cur_product->product_id == id) ?
+	       asCursorNext(cursor) : cur_product;
+}
+
+/*
+walkAmount - returns the amount of the current product of a walk, O(1)
+INPUT:
+	@param products - the storage
+	@param cursor - cursor of the walk, or NULL
+*/
+static double walkAmount(AmountSet products, ASCursor cursor) {
+
+	double amount = 0;
+	if (cursor != NULL) {
+		asCursorGetAmount(cursor, &amount);
+	}
+	else {
+		asGetCurrentAmount(products, &amount);
+	}
+	return amount;
+}
+
+/*
+printFilteredProducts - prints the products that pass the filter
+INPUT:
+	@param products - the storage, or a snapshot of it
+	@param read_only - true for the storage of a snapshot, it is walked
+	                   without allocating (customFilter doesnt use it)
+	@param customFilter - the filter
+	@param output - open stream to print into
+OUTPUT:
+	MATAMAZOM_OUT_OF_MEMORY if allocation failed, else MATAMAZOM_SUCCESS
+*/
+static MatamazomResult printFilteredProducts(AmountSet products,
+        bool read_only, MtmFilterProduct customFilter, FILE* output) {
+
+    double cur_amount = 0;
+
+    //walks the storage with a cursor, customFilter may call back into the
+    //warehouse and reset the internal iterator of the storage
+    ASCursor cursor = NULL;
+    if (!read_only) {
+        cursor = asCursorCreate(products);
+        if (cursor == NULL) {
+            return MATAMAZOM_OUT_OF_MEMORY;
+        }
+    }
+    Product cur_product = walkFirstProduct(products, cursor, NULL);
+    while (cur_product != NULL) {
+        //customFilter may clear the product, then it isnt printed. only
+        //products it accepts are priced
+        unsigned int id = cur_product->product_id;
+        cur_amount = walkAmount(products, cursor);
+        bool accepted = customFilter(id, getProductName(cur_product),
+                                     cur_amount,
+                                     cur_product->additional_data);
+        Product walked = (cursor != NULL) ? asCursorGet(cursor) :
+                                            cur_product;
+        if (accepted && walked != NULL && walked->product_id == id) {
+            mtmPrintProductDetails(getProductName(walked), id, cur_amount,
+                                   getProductPrice(walked, SINGLE), output);
+        }
+        cur_product = walkNextProduct(products, cursor, id);
+    }
+    asCursorDestroy(cursor);
+    return MATAMAZOM_SUCCESS;
+}
+
+/*
+queryProducts - fills a page of the products of an amount set, in id
+order, like printProductsInAmountSet and printFilteredProducts print them.
+O(log n + products walked)
+INPUT:
+	@param products - amount set of products
+	@param read_only - true for the storage of a snapshot, it is walked
+	                   without allocating (customFilter doesnt use it)
+	@param afterId - id of the last product of the previous page, NULL for
+	                 the first page
+	@param customFilter - products it rejects or clears are skipped, NULL
+	                      for none
+	@param flag - true for the price of the amount, false for a single unit
+	@param limit - room in items
+	@param items - where the products are returned
+	@param outCount - where the number of returned products is returned
+OUTPUT:
+	MATAMAZOM_OUT_OF_MEMORY if creating the cursor failed, else
+	MATAMAZOM_SUCCESS
+*/
+static MatamazomResult queryProducts(AmountSet products, bool read_only,
+        const unsigned int* afterId, MtmFilterProduct customFilter,
+        bool flag, int limit, MtmProductInfo* items, int* outCount) {
+
+	*outCount = 0;
+	if (limit <= 0 || (afterId != NULL && *afterId == UINT_MAX)) {
+		return MATAMAZOM_SUCCESS;
+	}
+
+	//walks with a cursor, customFilter may call back into the warehouse
+	ASCursor cursor = NULL;
+	if (!read_only) {
+		cursor = asCursorCreate(products);
+		if (cursor == NULL) {
+			return MATAMAZOM_OUT_OF_MEMORY;
+		}
+	}
+	struct Product_t key_product;//compareProduct reads only the id of it
+	if (afterId != NULL) {
+		key_product.product_id = *afterId + 1;
+	}
+	Product cur_product = walkFirstProduct(products, cursor,
+	                                       (afterId != NULL) ? &key_product :
+	                                                           NULL);
+	while (cur_product != NULL && *outCount < limit) {
+		MtmProductInfo* item = &items[*outCount];
+		item->id = cur_product->product_id;
+		item->amount = walkAmount(products, cursor);
+		bool accepted = (customFilter == NULL) ||
+		                customFilter(item->id, getProductName(cur_product),
+		                             item->amount,
+		                             cur_product->additional_data);
+
+		//a product the filter cleared isnt returned, the cursor was moved
+		//off it then. only returned products are priced
+		Product walked = (cursor != NULL) ? asCursorGet(cursor) :
+		                                    cur_product;
+		if (accepted && walked != NULL && walked->product_id == item->id) {
+			item->name = getProductName(walked);
+			item->price = getProductPrice(walked, (flag == true) ?
+			                                      item->amount : SINGLE);
+			(*outCount)++;
+		}
+		cur_product = walkNextProduct(products, cursor, item->id);
+	}
+	asCursorDestroy(cursor);
+	return MATAMAZOM_SUCCESS;
+}
+
+Matamazom matamazomCreate(){
+	return matamazomCreateWithAllocator(mtmDefaultAllocator());
+}
+
+Matamazom matamazomCreateWithAllocator(const MtmAllocator* allocator){
+
+	if (allocator == NULL || allocator->allocate == NULL) {
+		return NULL;
+	}
+	
+	//allocates matamzom and checks if valid
+	Matamazom allocated_matamazom = mtmAllocate(allocator,
+	                                            sizeof(*allocated_matamazom));
+    if (allocated_matamazom == NULL){//if fail - frees memory
+        return NULL;
+    }
+	//the warehouse keeps its own copy, products and orders point to it
+	allocated_matamazom->allocator = *allocator;
+	memset(&allocated_matamazom->memory, 0,
+	       sizeof(allocated_matamazom->memory));
+
+	//creates the name table first, products intern their names in it
+	allocated_matamazom->names =
+		nameTableCreate(&allocated_matamazom->allocator);
+	if (allocated_matamazom->names == NULL) {
+		mtmRelease(allocator, allocated_matamazom);
+		return NULL;
+	}
+	nameTableSetMemoryCounter(allocated_matamazom->names,
+	                          &allocated_matamazom->memory.names);
+	allocated_matamazom->name_index = nameIndexCreate(
+		allocated_matamazom->names, &allocated_matamazom->allocator);
+	if (allocated_matamazom->name_index == NULL) {
+		nameTableDestroy(allocated_matamazom->names);
+		mtmRelease(allocator, allocated_matamazom);
+		return NULL;
+	}
+	nameIndexSetMemoryCounter(allocated_matamazom->name_index,
+	                          &allocated_matamazom->memory.name_index);
+
+	//allocates amount set for products and checks if valid
+	//keyed by id, so searches compare the ids stored in the nodes
+	allocated_matamazom->products_storage=asCreateKeyed(copyProduct,
+		freeProduct, compareProduct, getProductKey,
+		&allocated_matamazom->allocator);
+    if (allocated_matamazom->products_storage == NULL){//if fail - frees memory
+        nameIndexDestroy(allocated_matamazom->name_index);
+        nameTableDestroy(allocated_matamazom->names);
+        mtmRelease(allocator, allocated_matamazom);
+        return NULL;
+    }
+	asSetMemoryCounter(allocated_matamazom->products_storage,
+	                   &allocated_matamazom->memory.nodes);
+	//snapshots share the storage until it changes
+	asSetCopyOnWrite(allocated_matamazom->products_storage, true);
+
+	//allocates list for products and checks if valid
+	//(list nodes are allocated by list.h and dont use the allocator)
+	allocated_matamazom->order_list =listCreate(copyOrder,freeOrder);
+    if(allocated_matamazom->order_list==NULL){//if fail - frees memory
+        asDestroy(allocated_matamazom->products_storage);
+        nameIndexDestroy(allocated_matamazom->name_index);
+        nameTableDestroy(allocated_matamazom->names);
+        mtmRelease(allocator, allocated_matamazom);
+        return NULL;
+    }
+
+	//creates the history of shipped orders
+	allocated_matamazom->sales_history =
+		salesHistoryCreate(&allocated_matamazom->allocator);
+	if (allocated_matamazom->sales_history == NULL) {
+		listDestroy(allocated_matamazom->order_list);
+		asDestroy(allocated_matamazom->products_storage);
+		nameIndexDestroy(allocated_matamazom->name_index);
+		nameTableDestroy(allocated_matamazom->names);
+		mtmRelease(allocator, allocated_matamazom);
+		return NULL;
+	}
+	salesHistorySetMemoryCounter(allocated_matamazom->sales_history,
+	                             &allocated_matamazom->memory.sales_history);
+
+	allocated_matamazom->num_orders = 0;
+	allocated_matamazom->reservation_mode = false;
+	allocated_matamazom->default_watcher = NULL;
+	allocated_matamazom->default_threshold = 0;
+	allocated_matamazom->default_context = NULL;
+	allocated_matamazom->changes = NULL;
+	allocated_matamazom->change_seq = 0;
+	allocated_matamazom->velocity_intervals = 0;
+	allocated_matamazom->sales_tick = 0;
+	allocated_matamazom->snapshots = 0;
+#ifdef MATAMAZOM_STATS
+	memset(&allocated_matamazom->stats, 0, sizeof(allocated_matamazom->stats));
+	asSetVisitCounter(allocated_matamazom->products_storage,
+	                  &allocated_matamazom->stats.nodes_visited);
+#endif
+	return allocated_matamazom;
+
+}
+
+const MtmAllocator* mtmGetAllocator(Matamazom matamazom) {
+	STATS_START(start);
+	const MtmAllocator* allocator = (matamazom == NULL) ? NULL :
+	                                &matamazom->allocator;
+	STATS_RECORD(matamazom, MTM_STATS_GET_ALLOCATOR,
+	             (matamazom == NULL) ? MATAMAZOM_NULL_ARGUMENT :
+	                                   MATAMAZOM_SUCCESS, start);
+	return allocator;
 }
 
 void matamazomDestroy(Matamazom matamazom){
@@ -490,13 +1577,18 @@ void matamazomDestroy(Matamazom matamazom){
 	//frees allocated memory in matamzom
 	asDestroy(matamazom->products_storage);
     listDestroy(matamazom->order_list);
-	//frees allocated matamazom
-	free(matamazom);
+	salesHistoryDestroy(matamazom->sales_history);
+	changeFeedDestroy(matamazom->changes);
+	nameIndexDestroy(matamazom->name_index);
+	nameTableDestroy(matamazom->names);//after every product is freed
+	//frees allocated matamazom, the allocator is copied out of it first
+	MtmAllocator allocator = matamazom->allocator;
+	mtmRelease(&allocator, matamazom);
 }
 
 //!!!!!!!!! check if customData gets free'd in main.c/mtm tests
 //for now, we use the copy data func to copy the custom data
-MatamazomResult mtmNewProduct(Matamazom matamazom, const unsigned int id,
+static MatamazomResult newProduct(Matamazom matamazom, const unsigned int id,
         const char *name,const double amount,const MatamazomAmountType
         amountType,const MtmProductData customData,
         MtmCopyData copyData,MtmFreeData freeData,
@@ -508,46 +1600,38 @@ MatamazomResult mtmNewProduct(Matamazom matamazom, const unsigned int id,
 	if (searchProductById(matamazom->products_storage, id) != NULL) {
 		return MATAMAZOM_PRODUCT_ALREADY_EXIST;
 	}
-	if (name == NULL || !(inRange(name[0], SMALL_Z, SMALL_A) ||
-		inRange(name[0], CAPITAL_Z, CAPITAL_A) ||
-		inRange(name[0], HIGHEST_DIGIT, SMALLEST_DIGIT))) {
+	if (!isValidProductName(name)) {
 		return MATAMAZOM_INVALID_NAME;
 	}
     if (amount < 0 || !isAmountConsistentWithAmountType(amount, amountType)){
         return MATAMAZOM_INVALID_AMOUNT;
     }
-    Product new_product = malloc(sizeof(*new_product));
+	Product new_product = createProduct(matamazom, id, name, amountType,
+	                                    customData, copyData, freeData,
+	                                    prodPrice);
     if(new_product == NULL){
         return MATAMAZOM_OUT_OF_MEMORY;
     }
-    new_product->product_id = id;
-    new_product->freeData = freeData;
-    new_product->copyData = copyData;
-    new_product->measurement_type = amountType;
-	new_product->prodPrice = prodPrice;
-	new_product->amount_sold=0;
-	new_product->additional_data = new_product->copyData(customData);
-	new_product->product_name = malloc(strlen(name) + 1);
-	if (new_product->product_name == NULL){
-		new_product->freeData(new_product->additional_data);
-		free(new_product);
+	if (!nameIndexInsert(matamazom->name_index, name, id)) {
+		freeProduct(new_product);
 		return MATAMAZOM_OUT_OF_MEMORY;
 	}
-	else {//allocation valid - copies string
-		strcpy(new_product->product_name, name);
-	}
     AmountSetResult result_value = asRegister(matamazom->products_storage, 
 		                                      new_product);
     if(result_value == AS_OUT_OF_MEMORY){
+		nameIndexRemove(matamazom->name_index, name, id);
         freeProduct(new_product);
         return MATAMAZOM_OUT_OF_MEMORY;
     }
 	asChangeAmount(matamazom->products_storage, new_product, amount);
+	recordChange(matamazom, MTM_CHANGE_PRODUCT_ADDED, id, 0, amount);
+	//a new product starts above every threshold
+	notifyWatch(new_product, INFINITY, amount);
     freeProduct(new_product);
     return MATAMAZOM_SUCCESS;
 }
 
-MatamazomResult mtmChangeProductAmount(Matamazom matamazom,
+static MatamazomResult changeProductAmount(Matamazom matamazom,
         const unsigned int id, const double amount){
     
 	//check null arguments
@@ -572,18 +1656,35 @@ MatamazomResult mtmChangeProductAmount(Matamazom matamazom,
         return MATAMAZOM_INVALID_AMOUNT;
     }
 
+	//reserved stock cant be taken out of the storage
+	double storage_amount = 0;
+	asGetCurrentAmount(matamazom->products_storage, &storage_amount);
+	if (matamazom->reservation_mode &&
+	    storage_amount + amount < ret_product->reserved) {
+		return MATAMAZOM_INSUFFICIENT_AMOUNT;
+	}
+
 	//changes amount and checks if amount insuffisient
-    if(asChangeAmount(matamazom->products_storage,ret_product,amount)==
-    AS_INSUFFICIENT_AMOUNT){
+	//(or if copying a storage shared with a snapshot failed)
+	AmountSetResult result_value = asChangeAmount(matamazom->products_storage,
+	                                              ret_product, amount);
+    if(result_value == AS_INSUFFICIENT_AMOUNT){
         return MATAMAZOM_INSUFFICIENT_AMOUNT;
     }
+	if (result_value == AS_OUT_OF_MEMORY) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	recordChange(matamazom, MTM_CHANGE_AMOUNT_CHANGED, id, 0,
+	             storage_amount + amount);
+	notifyWatch(ret_product, storage_amount, storage_amount + amount);
 
 	//passed all tests-success
     return MATAMAZOM_SUCCESS;
 }
 
 
-MatamazomResult mtmClearProduct(Matamazom matamazom, const unsigned int id){
+static MatamazomResult clearProduct(Matamazom matamazom,
+                                    const unsigned int id){
     
 	//check null arguments
 	if(matamazom == NULL){
@@ -600,31 +1701,45 @@ MatamazomResult mtmClearProduct(Matamazom matamazom, const unsigned int id){
     if(ret_product==NULL){
         return MATAMAZOM_PRODUCT_NOT_EXIST;
     }
+	//deleting from a storage shared with a snapshot copies it first
+	if (detachStorage(matamazom) != MATAMAZOM_SUCCESS) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	ret_product = searchProductById(matamazom->products_storage, id);
 
 	//clears product from all orders
     clearProductFromOrders(matamazom, id);
 
     //ret_product->freeData(ret_product->additional_data);
     
-	//clears product from matamzom storage
+	//clears product from the name index and matamzom storage
+	nameIndexRemove(matamazom->name_index, getProductName(ret_product), id);
 	asDelete(matamazom->products_storage,ret_product);
+	recordChange(matamazom, MTM_CHANGE_PRODUCT_CLEARED, id, 0, 0);
 
     return MATAMAZOM_SUCCESS;
 
 }
 
 
-unsigned int mtmCreateNewOrder(Matamazom matamazom){
+static unsigned int createNewOrder(Matamazom matamazom){
 
     if(matamazom==NULL){
         return ORDER_ERROR;
     }
     //creates a new order and checks if valid
-	Order new_order=orderCreate(matamazom->num_orders+1, copyProduct,
-							    freeProduct,compareProduct);
+	Order new_order=orderCreate(matamazom->num_orders+1, copyOrderLine,
+							    freeProduct,compareProduct, getProductKey,
+							    &matamazom->allocator);
     if(new_order==NULL){//if failed returns 0
 		return ORDER_ERROR;
     }
+	orderSetMemoryCounters(new_order, &matamazom->memory.order_headers,
+	                       &matamazom->memory.order_lines);
+#ifdef MATAMAZOM_STATS
+	asSetVisitCounter(new_order->order_products,
+	                  &matamazom->stats.nodes_visited);
+#endif
 
     //inserts order in list and checks if valid
 	ListResult result = listInsertLast(matamazom->order_list, new_order);
@@ -635,10 +1750,12 @@ unsigned int mtmCreateNewOrder(Matamazom matamazom){
     }
     orderDestroy(new_order);
 	//else return new number of orders
+	recordChange(matamazom, MTM_CHANGE_ORDER_CREATED, 0,
+	             matamazom->num_orders + 1, 0);
     return ++matamazom->num_orders;
 }
 
-MatamazomResult mtmChangeProductAmountInOrder(Matamazom matamazom,
+static MatamazomResult changeProductAmountInOrder(Matamazom matamazom,
                                               const unsigned int orderId,
                                               const unsigned int productId,
                                               const double amount){
@@ -653,6 +1770,13 @@ MatamazomResult mtmChangeProductAmountInOrder(Matamazom matamazom,
     if (ret_product==NULL){
         return MATAMAZOM_PRODUCT_NOT_EXIST;
     }
+	//the reservation is changed in place
+	if (matamazom->reservation_mode &&
+	    (ret_product = detachProduct(matamazom, productId)) == NULL) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	double storage_amount = 0;
+	asGetCurrentAmount(matamazom->products_storage, &storage_amount);
     if(isAmountConsistentWithAmountType(amount,ret_product->measurement_type)
     ==false){
         return MATAMAZOM_INVALID_AMOUNT;
@@ -665,14 +1789,23 @@ MatamazomResult mtmChangeProductAmountInOrder(Matamazom matamazom,
     if(amount==0){
         return MATAMAZOM_SUCCESS;
     }
+	if (matamazom->reservation_mode) {
+		MatamazomResult result = reserveOrderLine(matamazom, ret_order,
+		        ret_product, storage_amount - ret_product->reserved, amount);
+		if (result != MATAMAZOM_SUCCESS) {
+			return result;
+		}
+	}
     changeOrderProductAmount(ret_order,ret_product,amount);
+	recordOrderLine(matamazom, ret_order, ret_product);
 
     return MATAMAZOM_SUCCESS;
 
 
 }
 
-MatamazomResult mtmShipOrder(Matamazom matamazom, const unsigned int orderId) {
+static MatamazomResult shipOrder(Matamazom matamazom,
+                                 const unsigned int orderId) {
     if (matamazom == NULL) {
         return MATAMAZOM_NULL_ARGUMENT;
     }
@@ -680,16 +1813,26 @@ MatamazomResult mtmShipOrder(Matamazom matamazom, const unsigned int orderId) {
     if (ret_order == NULL) {
         return MATAMAZOM_ORDER_NOT_EXIST;
     }
-    if (checkInsufficientAmount(matamazom, ret_order) == false) {
+	//reserved orders always fit the stock
+    if (!matamazom->reservation_mode &&
+        checkInsufficientAmount(matamazom, ret_order) == false) {
 		return MATAMAZOM_INSUFFICIENT_AMOUNT;
     }
+	//reserves the history records first, so shipping cant fail halfway
+	if (!salesHistoryReserve(matamazom->sales_history,
+	                         asGetSize(ret_order->order_products)) ||
+	    detachOrderProducts(matamazom, ret_order) != MATAMAZOM_SUCCESS) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
     decreaseProductFromStorageByOrder(matamazom,ret_order);
-    mtmCancelOrder(matamazom,orderId);
+	removeOrder(matamazom, orderId);//the reservations were committed
+	recordChange(matamazom, MTM_CHANGE_ORDER_SHIPPED, 0, orderId, 0);
     return MATAMAZOM_SUCCESS;
 }
 
 
-MatamazomResult mtmCancelOrder(Matamazom matamazom, const unsigned int orderId){
+static MatamazomResult cancelOrder(Matamazom matamazom,
+                                   const unsigned int orderId){
     if(matamazom==NULL){
         return MATAMAZOM_NULL_ARGUMENT;
     }
@@ -697,16 +1840,19 @@ MatamazomResult mtmCancelOrder(Matamazom matamazom, const unsigned int orderId){
     if(ret_order==NULL){
         return MATAMAZOM_ORDER_NOT_EXIST;
     }
-    LIST_FOREACH(Order,current_order,matamazom->order_list){
-        if(current_order->order_id==orderId){
-			listRemoveCurrent(matamazom->order_list);
-        }
-    }
+	if (matamazom->reservation_mode) {
+		if (detachOrderProducts(matamazom, ret_order) != MATAMAZOM_SUCCESS) {
+			return MATAMAZOM_OUT_OF_MEMORY;
+		}
+		releaseOrderReservations(matamazom, ret_order);
+	}
+	removeOrder(matamazom, orderId);
+	recordChange(matamazom, MTM_CHANGE_ORDER_CANCELLED, 0, orderId, 0);
     return MATAMAZOM_SUCCESS;
 }
 
 
-MatamazomResult mtmPrintInventory(Matamazom matamazom, FILE* output) {
+static MatamazomResult printInventory(Matamazom matamazom, FILE* output) {
 
     if (matamazom == NULL || output == NULL) {
         return MATAMAZOM_NULL_ARGUMENT;
@@ -724,8 +1870,8 @@ MatamazomResult mtmPrintInventory(Matamazom matamazom, FILE* output) {
     return MATAMAZOM_SUCCESS;
 }
 
-MatamazomResult mtmPrintOrder(Matamazom matamazom, const unsigned int orderId,
-        FILE* output) {
+static MatamazomResult printOrder(Matamazom matamazom,
+                                  const unsigned int orderId, FILE* output) {
 
     if (matamazom == NULL || output == NULL) {
         return MATAMAZOM_NULL_ARGUMENT;
@@ -747,64 +1893,1919 @@ MatamazomResult mtmPrintOrder(Matamazom matamazom, const unsigned int orderId,
     return MATAMAZOM_SUCCESS;
 }
 
-MatamazomResult mtmPrintBestSelling(Matamazom matamazom, FILE* output) {
+static MatamazomResult printBestSelling(Matamazom matamazom, FILE* output) {
 
     if (matamazom == NULL || output == NULL) {
         return MATAMAZOM_NULL_ARGUMENT;
     }
 
-	//print header
-	fprintf(output,"Best Selling Product:\n");
-    Product best_seller = getBestProfitableProduct(matamazom);
-    
-	if (best_seller != NULL)
-	{
-		mtmPrintIncomeLine(best_seller->product_name, best_seller->product_id,
-			best_seller->prodPrice(best_seller->additional_data,
-				best_seller->amount_sold)
-			,output);
-	}
-	else
-	{
-		fprintf(output,"none\n");
-	}
-	
-
+    printBestSellingProduct(matamazom->products_storage, output);
     return MATAMAZOM_SUCCESS;
 }
 
-MatamazomResult mtmPrintFiltered(Matamazom matamazom,
+static MatamazomResult printFiltered(Matamazom matamazom,
         MtmFilterProduct customFilter, FILE* output) {
 
     if (matamazom == NULL || customFilter == NULL || output == NULL) {
         return MATAMAZOM_NULL_ARGUMENT;
     }
 
-    double cur_amount = 0;
+    return printFilteredProducts(matamazom->products_storage, false,
+                                 customFilter, output);
+}
 
-    //using macro to search inside order products amount
-    //note that cur_product is set to be product obj
-    AS_FOREACH(Product, cur_product, matamazom->products_storage) {
-        AS_FOREACH(Product, cur_product, matamazom->products_storage) {
-            asGetAmount(matamazom->products_storage, cur_product,
-                        &cur_amount);
-            if (customFilter(cur_product->product_id,
-                             cur_product->product_name, cur_amount,
-                             cur_product->additional_data)) {
-
-                mtmPrintProductDetails(cur_product->product_name,
-                                       cur_product->product_id, cur_amount,
-                                       cur_product->prodPrice
-                                               (cur_product->additional_data,
-                                                SINGLE),
-                                       output);
-            }
-        }
-    }
-    return MATAMAZOM_SUCCESS;
+//instrumented entry points, comments on matamazom.h
+
+MatamazomResult mtmNewProduct(Matamazom matamazom, const unsigned int id,
+        const char *name,const double amount,const MatamazomAmountType
+        amountType,const MtmProductData customData,
+        MtmCopyData copyData,MtmFreeData freeData,
+        MtmGetProductPrice prodPrice){
+	STATS_START(start);
+	MatamazomResult result = newProduct(matamazom, id, name, amount,
+	                                    amountType, customData, copyData,
+	                                    freeData, prodPrice);
+	STATS_RECORD(matamazom, MTM_STATS_NEW_PRODUCT, result, start);
+	publishChanges(matamazom);
+	return result;
+}
+
+MatamazomResult mtmChangeProductAmount(Matamazom matamazom,
+        const unsigned int id, const double amount){
+	STATS_START(start);
+	MatamazomResult result = changeProductAmount(matamazom, id, amount);
+	STATS_RECORD(matamazom, MTM_STATS_CHANGE_PRODUCT_AMOUNT, result, start);
+	publishChanges(matamazom);
+	return result;
+}
+
+MatamazomResult mtmClearProduct(Matamazom matamazom, const unsigned int id){
+	STATS_START(start);
+	MatamazomResult result = clearProduct(matamazom, id);
+	STATS_RECORD(matamazom, MTM_STATS_CLEAR_PRODUCT, result, start);
+	publishChanges(matamazom);
+	return result;
+}
+
+unsigned int mtmCreateNewOrder(Matamazom matamazom){
+	STATS_START(start);
+	unsigned int order_id = createNewOrder(matamazom);
+	STATS_RECORD(matamazom, MTM_STATS_CREATE_NEW_ORDER,
+	             (order_id == ORDER_ERROR) ? MATAMAZOM_OUT_OF_MEMORY :
+	                                         MATAMAZOM_SUCCESS, start);
+	publishChanges(matamazom);
+	return order_id;
+}
+
+MatamazomResult mtmChangeProductAmountInOrder(Matamazom matamazom,
+                                              const unsigned int orderId,
+                                              const unsigned int productId,
+                                              const double amount){
+	STATS_START(start);
+	MatamazomResult result = changeProductAmountInOrder(matamazom, orderId,
+	                                                    productId, amount);
+	STATS_RECORD(matamazom, MTM_STATS_CHANGE_PRODUCT_AMOUNT_IN_ORDER, result,
+	             start);
+	publishChanges(matamazom);
+	return result;
+}
+
+MatamazomResult mtmShipOrder(Matamazom matamazom, const unsigned int orderId) {
+	STATS_START(start);
+	MatamazomResult result = shipOrder(matamazom, orderId);
+	STATS_RECORD(matamazom, MTM_STATS_SHIP_ORDER, result, start);
+	publishChanges(matamazom);
+	return result;
+}
+
+MatamazomResult mtmCancelOrder(Matamazom matamazom, const unsigned int orderId){
+	STATS_START(start);
+	MatamazomResult result = cancelOrder(matamazom, orderId);
+	STATS_RECORD(matamazom, MTM_STATS_CANCEL_ORDER, result, start);
+	publishChanges(matamazom);
+	return result;
+}
+
+MatamazomResult mtmPrintInventory(Matamazom matamazom, FILE* output) {
+	STATS_START(start);
+	MatamazomResult result = printInventory(matamazom, output);
+	STATS_RECORD(matamazom, MTM_STATS_PRINT_INVENTORY, result, start);
+	return result;
+}
+
+MatamazomResult mtmPrintOrder(Matamazom matamazom, const unsigned int orderId,
+        FILE* output) {
+	STATS_START(start);
+	MatamazomResult result = printOrder(matamazom, orderId, output);
+	STATS_RECORD(matamazom, MTM_STATS_PRINT_ORDER, result, start);
+	return result;
+}
+
+MatamazomResult mtmPrintBestSelling(Matamazom matamazom, FILE* output) {
+	STATS_START(start);
+	MatamazomResult result = printBestSelling(matamazom, output);
+	STATS_RECORD(matamazom, MTM_STATS_PRINT_BEST_SELLING, result, start);
+	return result;
+}
+
+MatamazomResult mtmPrintFiltered(Matamazom matamazom,
+        MtmFilterProduct customFilter, FILE* output) {
+	STATS_START(start);
+	MatamazomResult result = printFiltered(matamazom, customFilter, output);
+	STATS_RECORD(matamazom, MTM_STATS_PRINT_FILTERED, result, start);
+	return result;
+}
+
+MatamazomResult mtmOrderEditBegin(Matamazom matamazom,
+                                  const unsigned int orderId,
+                                  MtmOrderEdit* edit) {
+	STATS_START(start);
+	MatamazomResult result = orderEditBegin(matamazom, orderId, edit);
+	STATS_RECORD(matamazom, MTM_STATS_ORDER_EDIT_BEGIN, result, start);
+	return result;
+}
 
+MatamazomResult mtmOrderEditStage(MtmOrderEdit edit,
+                                  const unsigned int productId,
+                                  const double amount) {
+	STATS_START(start);
+	STATS_SOURCE(stats, (edit == NULL) ? NULL : &edit->matamazom->stats);
+	MatamazomResult result = orderEditStage(edit, productId, amount);
+	STATS_RECORD_IN(stats, MTM_STATS_ORDER_EDIT_STAGE, result, start);
+	return result;
 }
 
+MatamazomResult mtmOrderEditCommit(MtmOrderEdit edit) {
+	STATS_START(start);
+	STATS_SOURCE(stats, (edit == NULL) ? NULL : &edit->matamazom->stats);
+	MatamazomResult result = orderEditCommit(edit);
+	STATS_RECORD_IN(stats, MTM_STATS_ORDER_EDIT_COMMIT, result, start);
+	return result;
+}
+
+void mtmOrderEditAbort(MtmOrderEdit edit) {
+	STATS_START(start);
+	STATS_SOURCE(stats, (edit == NULL) ? NULL : &edit->matamazom->stats);
+	orderEditAbort(edit);
+	STATS_RECORD_IN(stats, MTM_STATS_ORDER_EDIT_ABORT,
+	                (edit == NULL) ? MATAMAZOM_NULL_ARGUMENT :
+	                                 MATAMAZOM_SUCCESS, start);
+}
+
+MatamazomResult mtmMergeOrders(Matamazom matamazom, const unsigned int targetId,
+                               const unsigned int* sourceIds, const int count) {
+	STATS_START(start);
+	MatamazomResult result = mergeOrders(matamazom, targetId, sourceIds, count);
+	STATS_RECORD(matamazom, MTM_STATS_MERGE_ORDERS, result, start);
+	return result;
+}
+
+MatamazomResult mtmPrintInventoryRange(Matamazom matamazom,
+                                       const unsigned int lowId,
+                                       const unsigned int highId,
+                                       FILE* output) {
+	STATS_START(start);
+	MatamazomResult result = printInventoryRange(matamazom, lowId, highId,
+	                                             output);
+	STATS_RECORD(matamazom, MTM_STATS_PRINT_INVENTORY_RANGE, result, start);
+	return result;
+}
+
+MatamazomResult mtmFindProductsByPrefix(Matamazom matamazom, const char* prefix,
+                                        MtmProductVisitor visitor,
+                                        void* context) {
+	STATS_START(start);
+	MatamazomResult result = findProductsByPrefix(matamazom, prefix, visitor,
+	                                              context);
+	STATS_RECORD(matamazom, MTM_STATS_FIND_PRODUCTS_BY_PREFIX, result, start);
+	return result;
+}
+
+MatamazomResult mtmFindProductsByName(Matamazom matamazom, const char* name,
+                                      MtmProductVisitor visitor,
+                                      void* context) {
+	STATS_START(start);
+	MatamazomResult result = findProductsByName(matamazom, name, visitor,
+	                                            context);
+	STATS_RECORD(matamazom, MTM_STATS_FIND_PRODUCTS_BY_NAME, result, start);
+	return result;
+}
+
+MatamazomResult mtmGetSalesRevenue(Matamazom matamazom,
+                                   const unsigned int lastShipments,
+                                   const unsigned int lowId,
+                                   const unsigned int highId,
+                                   double* outRevenue) {
+	STATS_START(start);
+	MatamazomResult result = getSalesRevenue(matamazom, lastShipments, lowId,
+	                                         highId, outRevenue);
+	STATS_RECORD(matamazom, MTM_STATS_GET_SALES_REVENUE, result, start);
+	return result;
+}
+
+MatamazomResult mtmImportProducts(Matamazom matamazom, MtmProductReader reader,
+                                  void* context) {
+	STATS_START(start);
+	MatamazomResult result = importProducts(matamazom, reader, context);
+	STATS_RECORD(matamazom, MTM_STATS_IMPORT_PRODUCTS, result, start);
+	return result;
+}
+
+MatamazomResult mtmSetReservationMode(Matamazom matamazom, bool enabled) {
+	STATS_START(start);
+	MatamazomResult result = setReservationMode(matamazom, enabled);
+	STATS_RECORD(matamazom, MTM_STATS_SET_RESERVATION_MODE, result, start);
+	return result;
+}
+
+MatamazomResult mtmGetAvailableAmount(Matamazom matamazom,
+                                      const unsigned int productId,
+                                      double* outAmount) {
+	STATS_START(start);
+	MatamazomResult result = getAvailableAmount(matamazom, productId,
+	                                            outAmount);
+	STATS_RECORD(matamazom, MTM_STATS_GET_AVAILABLE_AMOUNT, result, start);
+	return result;
+}
+
+MatamazomResult mtmWatchAmountBelow(Matamazom matamazom,
+                                    const unsigned int productId,
+                                    const double threshold,
+                                    MtmAmountWatcher watcher, void* context) {
+	STATS_START(start);
+	MatamazomResult result = watchAmountBelow(matamazom, productId, threshold,
+	                                          watcher, context);
+	STATS_RECORD(matamazom, MTM_STATS_WATCH_AMOUNT_BELOW, result, start);
+	return result;
+}
+
+MatamazomResult mtmWatchAllAmountsBelow(Matamazom matamazom,
+                                        const double threshold,
+                                        MtmAmountWatcher watcher,
+                                        void* context) {
+	STATS_START(start);
+	MatamazomResult result = watchAllAmountsBelow(matamazom, threshold, watcher,
+	                                              context);
+	STATS_RECORD(matamazom, MTM_STATS_WATCH_ALL_AMOUNTS_BELOW, result, start);
+	return result;
+}
+
+MatamazomResult mtmSetDataSizeFunction(Matamazom matamazom,
+                                       MtmGetDataSize dataSize) {
+	STATS_START(start);
+	MatamazomResult result = setDataSizeFunction(matamazom, dataSize);
+	STATS_RECORD(matamazom, MTM_STATS_SET_DATA_SIZE_FUNCTION, result, start);
+	return result;
+}
+
+MatamazomResult mtmGetMemoryUsage(Matamazom matamazom, MtmMemoryUsage* usage) {
+	STATS_START(start);
+	MatamazomResult result = getMemoryUsage(matamazom, usage);
+	STATS_RECORD(matamazom, MTM_STATS_GET_MEMORY_USAGE, result, start);
+	return result;
+}
+
+MatamazomResult mtmPrepareShipOrder(Matamazom matamazom,
+                                    const unsigned int orderId) {
+	STATS_START(start);
+	MatamazomResult result = prepareShipOrder(matamazom, orderId);
+	STATS_RECORD(matamazom, MTM_STATS_PREPARE_SHIP_ORDER, result, start);
+	return result;
+}
+
+MatamazomResult mtmGetBestSelling(Matamazom matamazom, unsigned int* outId,
+                                  double* outIncome, const char** outName) {
+	STATS_START(start);
+	MatamazomResult result = getBestSelling(matamazom, outId, outIncome,
+	                                        outName);
+	STATS_RECORD(matamazom, MTM_STATS_GET_BEST_SELLING, result, start);
+	return result;
+}
+
+MtmSnapshot mtmSnapshotCreate(Matamazom matamazom) {
+	STATS_START(start);
+	MtmSnapshot snapshot = snapshotCreate(matamazom);
+	STATS_RECORD(matamazom, MTM_STATS_SNAPSHOT_CREATE,
+	             (matamazom == NULL) ? MATAMAZOM_NULL_ARGUMENT :
+	             (snapshot == NULL) ? MATAMAZOM_OUT_OF_MEMORY :
+	                                  MATAMAZOM_SUCCESS, start);
+	return snapshot;
+}
+
+void mtmSnapshotDestroy(MtmSnapshot snapshot) {
+	STATS_START(start);
+	STATS_SOURCE(stats, (snapshot == NULL) ? NULL : snapshot->stats);
+	snapshotDestroy(snapshot);
+	STATS_RECORD_IN(stats, MTM_STATS_SNAPSHOT_DESTROY,
+	                (snapshot == NULL) ? MATAMAZOM_NULL_ARGUMENT :
+	                                     MATAMAZOM_SUCCESS, start);
+}
+
+MatamazomResult mtmSnapshotGetProductAmount(MtmSnapshot snapshot,
+                                            const unsigned int productId,
+                                            double* outAmount) {
+	STATS_START(start);
+	STATS_SOURCE(stats, (snapshot == NULL) ? NULL : snapshot->stats);
+	MatamazomResult result = snapshotGetProductAmount(snapshot, productId,
+	                                                  outAmount);
+	STATS_RECORD_IN(stats, MTM_STATS_SNAPSHOT_GET_PRODUCT_AMOUNT, result,
+	                start);
+	return result;
+}
+
+MatamazomResult mtmSnapshotPrintInventory(MtmSnapshot snapshot,
+                                          FILE* output) {
+	STATS_START(start);
+	STATS_SOURCE(stats, (snapshot == NULL) ? NULL : snapshot->stats);
+	MatamazomResult result = snapshotPrintInventory(snapshot, output);
+	STATS_RECORD_IN(stats, MTM_STATS_SNAPSHOT_PRINT_INVENTORY, result, start);
+	return result;
+}
+
+MatamazomResult mtmSnapshotPrintBestSelling(MtmSnapshot snapshot,
+                                            FILE* output) {
+	STATS_START(start);
+	STATS_SOURCE(stats, (snapshot == NULL) ? NULL : snapshot->stats);
+	MatamazomResult result = snapshotPrintBestSelling(snapshot, output);
+	STATS_RECORD_IN(stats, MTM_STATS_SNAPSHOT_PRINT_BEST_SELLING, result,
+	                start);
+	return result;
+}
+
+MatamazomResult mtmSnapshotPrintFiltered(MtmSnapshot snapshot,
+                                         MtmFilterProduct customFilter,
+                                         FILE* output) {
+	STATS_START(start);
+	STATS_SOURCE(stats, (snapshot == NULL) ? NULL : snapshot->stats);
+	MatamazomResult result = snapshotPrintFiltered(snapshot, customFilter,
+	                                               output);
+	STATS_RECORD_IN(stats, MTM_STATS_SNAPSHOT_PRINT_FILTERED, result, start);
+	return result;
+}
+
+MatamazomResult mtmEnableChangeFeed(Matamazom matamazom, int capacity,
+                                    MtmChangeListener listener, int batch,
+                                    void* context) {
+	STATS_START(start);
+	MatamazomResult result = enableChangeFeed(matamazom, capacity, listener,
+	                                          batch, context);
+	STATS_RECORD(matamazom, MTM_STATS_ENABLE_CHANGE_FEED, result, start);
+	return result;
+}
+
+MatamazomResult mtmPollChanges(Matamazom matamazom, unsigned long afterSeq,
+                               MtmChange* changes, int max, int* outCount) {
+	STATS_START(start);
+	MatamazomResult result = pollChanges(matamazom, afterSeq, changes, max,
+	                                     outCount);
+	STATS_RECORD(matamazom, MTM_STATS_POLL_CHANGES, result, start);
+	return result;
+}
+
+MatamazomResult mtmFlushChanges(Matamazom matamazom) {
+	STATS_START(start);
+	MatamazomResult result = flushChanges(matamazom);
+	STATS_RECORD(matamazom, MTM_STATS_FLUSH_CHANGES, result, start);
+	return result;
+}
+
+MatamazomResult mtmQueryInventory(Matamazom matamazom,
+                                  const unsigned int* afterId, int limit,
+                                  MtmProductInfo* items, int* outCount) {
+	STATS_START(start);
+	MatamazomResult result = queryInventory(matamazom, afterId, limit, items,
+	                                        outCount);
+	STATS_RECORD(matamazom, MTM_STATS_QUERY_INVENTORY, result, start);
+	return result;
+}
+
+MatamazomResult mtmQueryOrder(Matamazom matamazom,
+                              const unsigned int orderId,
+                              const unsigned int* afterId, int limit,
+                              MtmProductInfo* items, int* outCount) {
+	STATS_START(start);
+	MatamazomResult result = queryOrder(matamazom, orderId, afterId, limit,
+	                                    items, outCount);
+	STATS_RECORD(matamazom, MTM_STATS_QUERY_ORDER, result, start);
+	return result;
+}
+
+MatamazomResult mtmQueryFiltered(Matamazom matamazom,
+                                 MtmFilterProduct customFilter,
+                                 const unsigned int* afterId, int limit,
+                                 MtmProductInfo* items, int* outCount) {
+	STATS_START(start);
+	MatamazomResult result = queryFiltered(matamazom, customFilter, afterId,
+	                                       limit, items, outCount);
+	STATS_RECORD(matamazom, MTM_STATS_QUERY_FILTERED, result, start);
+	return result;
+}
+
+MatamazomResult mtmSnapshotQueryInventory(MtmSnapshot snapshot,
+                                          const unsigned int* afterId,
+                                          int limit, MtmProductInfo* items,
+                                          int* outCount) {
+	STATS_START(start);
+	STATS_SOURCE(stats, (snapshot == NULL) ? NULL : snapshot->stats);
+	MatamazomResult result = snapshotQueryInventory(snapshot, afterId, limit,
+	                                                items, outCount);
+	STATS_RECORD_IN(stats, MTM_STATS_SNAPSHOT_QUERY_INVENTORY, result,
+	                start);
+	return result;
+}
+
+MatamazomResult mtmSetSalesVelocityWindow(Matamazom matamazom,
+                                          int intervals) {
+	STATS_START(start);
+	MatamazomResult result = setSalesVelocityWindow(matamazom, intervals);
+	STATS_RECORD(matamazom, MTM_STATS_SET_SALES_VELOCITY_WINDOW, result,
+	             start);
+	return result;
+}
+
+MatamazomResult mtmTickSalesInterval(Matamazom matamazom) {
+	STATS_START(start);
+	MatamazomResult result = tickSalesInterval(matamazom);
+	STATS_RECORD(matamazom, MTM_STATS_TICK_SALES_INTERVAL, result, start);
+	return result;
+}
 
+MatamazomResult mtmGetSalesVelocity(Matamazom matamazom,
+                                    const unsigned int productId,
+                                    double* outAverage) {
+	STATS_START(start);
+	MatamazomResult result = getSalesVelocity(matamazom, productId,
+	                                          outAverage);
+	STATS_RECORD(matamazom, MTM_STATS_GET_SALES_VELOCITY, result, start);
+	return result;
+}
 
+MatamazomResult mtmReserveCapacity(Matamazom matamazom,
+                                   int expectedProducts,
+                                   int expectedShippedLines) {
+	STATS_START(start);
+	MatamazomResult result = reserveCapacity(matamazom, expectedProducts,
+	                                         expectedShippedLines);
+	STATS_RECORD(matamazom, MTM_STATS_RESERVE_CAPACITY, result, start);
+	return result;
+}
 
+MatamazomResult mtmReserveOrderLines(Matamazom matamazom,
+                                     const unsigned int orderId,
+                                     int expectedLines) {
+	STATS_START(start);
+	MatamazomResult result = reserveOrderLines(matamazom, orderId,
+	                                           expectedLines);
+	STATS_RECORD(matamazom, MTM_STATS_RESERVE_ORDER_LINES, result, start);
+	return result;
+}
+
+//stats functions with comments on matamazom_stats.h
+
+MatamazomResult mtmGetStats(Matamazom matamazom, MatamazomStats* stats) {
+
+    if (matamazom == NULL || stats == NULL) {
+        return MATAMAZOM_NULL_ARGUMENT;
+    }
+#ifdef MATAMAZOM_STATS
+    *stats = matamazom->stats;
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+    return MATAMAZOM_SUCCESS;
+}
+
+void mtmStatsRecordCall(Matamazom matamazom, MtmStatsApi api,
+                        MatamazomResult result, double start) {
+#ifdef MATAMAZOM_STATS
+    STATS_RECORD(matamazom, api, result, start);
+#else
+    (void)matamazom;
+    (void)api;
+    (void)result;
+    (void)start;
+#endif
+}
+
+MatamazomResult mtmDumpStats(Matamazom matamazom, FILE* output) {
+
+    if (matamazom == NULL || output == NULL) {
+        return MATAMAZOM_NULL_ARGUMENT;
+    }
+#ifdef MATAMAZOM_STATS
+    mtmStatsPrint(&matamazom->stats, output);
+#else
+    fprintf(output, "Matamazom Stats: disabled\n");
+#endif
+    return MATAMAZOM_SUCCESS;
+}
+
+/*
+compareOrderEditLines - qsort compare of order edit lines, by product id
+and then by staging order
+*/
+static int compareOrderEditLines(const void* line1, const void* line2) {
+
+	const OrderEditLine* first = line1;
+	const OrderEditLine* second = line2;
+	if (first->product_id != second->product_id) {
+		return (first->product_id < second->product_id) ? -1 : 1;
+	}
+	return first->seq - second->seq;
+}
+
+/*
+validateOrderEdit - validates the sorted lines of an edit against the
+storage, and sets the storage product of every line. every distinct id is
+found by seeking a cursor, so the key directory of the storage is used:
+O(k log n) for k lines
+INPUT:
+	@param edit - edit with lines sorted by compareOrderEditLines
+OUTPUT:
+	MATAMAZOM_OUT_OF_MEMORY - if creating the cursor failed
+	MATAMAZOM_PRODUCT_NOT_EXIST - if a line product isnt in the storage
+	MATAMAZOM_INVALID_AMOUNT - if a line amount doesnt fit its product
+	MATAMAZOM_SUCCESS - otherwise
+*/
+static MatamazomResult validateOrderEdit(MtmOrderEdit edit) {
+
+	ASCursor cursor = asCursorCreate(edit->matamazom->products_storage);
+	if (cursor == NULL) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	MatamazomResult result = MATAMAZOM_SUCCESS;
+	int line = 0;
+	while (line < edit->size && result == MATAMAZOM_SUCCESS) {
+		struct Product_t key_product;//compareProduct reads only the id
+		key_product.product_id = edit->lines[line].product_id;
+		Product cur_product = asCursorSeek(cursor, &key_product);
+		if (cur_product == NULL ||
+		    cur_product->product_id != key_product.product_id) {
+			result = MATAMAZOM_PRODUCT_NOT_EXIST;
+			break;
+		}
+		double storage_amount = 0;
+		asCursorGetAmount(cursor, &storage_amount);
+		for (; line < edit->size &&
+		       edit->lines[line].product_id == cur_product->product_id;
+		     line++) {
+			if (!isAmountConsistentWithAmountType(edit->lines[line].amount,
+			                               cur_product->measurement_type)) {
+				result = MATAMAZOM_INVALID_AMOUNT;
+				break;
+			}
+			edit->lines[line].available = storage_amount -
+			                              cur_product->reserved;
+			edit->lines[line].product = cur_product;
+		}
+	}
+	asCursorDestroy(cursor);
+	return result;
+}
+
+/*
+buildOrderEditUpdates - folds the lines of every product into a single
+update of the order, with the same result as calling
+mtmChangeProductAmountInOrder for each line in staging order.
+the order is walked once, in parallel with the sorted lines
+INPUT:
+	@param edit - validated edit
+	@param order - the edited order
+	@param updates - array with room for edit->size updates
+	@param deltas - array with room for edit->size amounts, gets the change
+	                of the order amount of each update
+OUTPUT:
+	number of updates written
+*/
+static int buildOrderEditUpdates(MtmOrderEdit edit, Order order,
+                                 ASUpdate* updates, double* deltas) {
+
+	int count = 0;
+	int line = 0;
+	double cur_amount = 0;
+	Product order_product = asGetFirst(order->order_products);
+	while (line < edit->size) {
+		Product cur_product = edit->lines[line].product;
+
+		//forwards the order walk to the product of the lines
+		while (order_product != NULL &&
+		       order_product->product_id < cur_product->product_id) {
+			order_product = asGetNext(order->order_products);
+		}
+		bool exists = order_product != NULL &&
+		              order_product->product_id == cur_product->product_id;
+		if (exists) {
+			asGetCurrentAmount(order->order_products, &cur_amount);
+		}
+		bool existed = exists;
+		double old_amount = exists ? cur_amount : 0;
+		for (; line < edit->size && edit->lines[line].product == cur_product;
+		     line++) {
+			double amount = edit->lines[line].amount;
+			if (!exists) {//same as changeOrderProductAmount
+				exists = amount > 0;
+				cur_amount = exists ? amount : 0;
+			}
+			else if (cur_amount + amount < 0) {
+				exists = false;
+			}
+			else {
+				cur_amount += amount;
+			}
+		}
+		if (exists || existed) {
+			updates[count].element = cur_product;
+			updates[count].amount = cur_amount;
+			updates[count].remove = !exists;
+			deltas[count] = (exists ? cur_amount : 0) - old_amount;
+			count++;
+		}
+	}
+	return count;
+}
+
+/*
+checkOrderEditReservations - checks that the unreserved stock covers the
+amounts an edit adds, in reservation mode
+INPUT:
+	@param edit - validated edit
+	@param updates - the updates built by buildOrderEditUpdates
+	@param deltas - the order amount changes of the updates
+	@param count - number of updates
+OUTPUT:
+	MATAMAZOM_INSUFFICIENT_AMOUNT - if a product doesnt have enough stock
+	MATAMAZOM_SUCCESS - otherwise
+*/
+static MatamazomResult checkOrderEditReservations(MtmOrderEdit edit,
+        const ASUpdate* updates, const double* deltas, int count) {
+
+	//updates and lines are both sorted by product
+	int line = 0;
+	for (int i = 0; i < count; i++) {
+		while (edit->lines[line].product != updates[i].element) {
+			line++;
+		}
+		if (deltas[i] > edit->lines[line].available) {
+			return MATAMAZOM_INSUFFICIENT_AMOUNT;
+		}
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+//order edit functions with comments on matamazom_ext.h
+
+static MatamazomResult orderEditBegin(Matamazom matamazom,
+                                      const unsigned int orderId,
+                                      MtmOrderEdit* edit) {
+
+    if (matamazom == NULL || edit == NULL) {
+        return MATAMAZOM_NULL_ARGUMENT;
+    }
+    if (searchOrderById(matamazom->order_list, orderId) == NULL) {
+        return MATAMAZOM_ORDER_NOT_EXIST;
+    }
+
+	//allocates the edit and its lines and checks if valid
+	MtmOrderEdit new_edit = mtmAllocate(&matamazom->allocator,
+	                                    sizeof(*new_edit));
+    if (new_edit == NULL) {
+        return MATAMAZOM_OUT_OF_MEMORY;
+    }
+	new_edit->lines = mtmAllocate(&matamazom->allocator,
+	                  EDIT_INITIAL_CAPACITY * sizeof(*new_edit->lines));
+    if (new_edit->lines == NULL) {
+        mtmRelease(&matamazom->allocator, new_edit);
+        return MATAMAZOM_OUT_OF_MEMORY;
+    }
+	new_edit->matamazom = matamazom;
+	new_edit->order_id = orderId;
+	new_edit->size = 0;
+	new_edit->capacity = EDIT_INITIAL_CAPACITY;
+
+	*edit = new_edit;
+    return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult orderEditStage(MtmOrderEdit edit,
+                                      const unsigned int productId,
+                                      const double amount) {
+
+    if (edit == NULL) {
+        return MATAMAZOM_NULL_ARGUMENT;
+    }
+
+	//grows the lines array when full
+	if (edit->size == edit->capacity) {
+		const MtmAllocator* allocator = &edit->matamazom->allocator;
+		OrderEditLine* new_lines = mtmAllocate(allocator,
+		                       2 * edit->capacity * sizeof(*new_lines));
+		if (new_lines == NULL) {
+			return MATAMAZOM_OUT_OF_MEMORY;
+		}
+		memcpy(new_lines, edit->lines, edit->size * sizeof(*new_lines));
+		mtmRelease(allocator, edit->lines);
+		edit->lines = new_lines;
+		edit->capacity *= 2;
+	}
+
+	OrderEditLine* new_line = &edit->lines[edit->size];
+	new_line->product_id = productId;
+	new_line->amount = amount;
+	new_line->seq = edit->size;
+	new_line->product = NULL;
+	edit->size++;
+    return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult orderEditCommit(MtmOrderEdit edit) {
+
+    if (edit == NULL) {
+        return MATAMAZOM_NULL_ARGUMENT;
+    }
+
+	Matamazom matamazom = edit->matamazom;
+	Order order = searchOrderById(matamazom->order_list, edit->order_id);
+	if (order == NULL) {
+		orderEditAbort(edit);
+		return MATAMAZOM_ORDER_NOT_EXIST;
+	}
+
+	//sorts the lines by id and validates them with one cursor of the
+	//storage (which keeps the storage products, for their reservations)
+	qsort(edit->lines, edit->size, sizeof(*edit->lines),
+	      compareOrderEditLines);
+	MatamazomResult result = validateOrderEdit(edit);
+
+	//reservations change the storage records in place, a snapshot may
+	//still share them
+	for (int i = 0; result == MATAMAZOM_SUCCESS &&
+	     matamazom->reservation_mode && matamazom->snapshots > 0 &&
+	     i < edit->size; i++) {
+		OrderEditLine* line = &edit->lines[i];
+		if (i > 0 && line->product_id == line[-1].product_id) {
+			line->product = line[-1].product;
+		}
+		else if ((line->product = detachProduct(matamazom,
+		                                        line->product_id)) == NULL) {
+			result = MATAMAZOM_OUT_OF_MEMORY;
+		}
+	}
+	if (result != MATAMAZOM_SUCCESS) {
+		orderEditAbort(edit);
+		return result;
+	}
+
+	//folds the lines per product and applies them in one walk of the order
+	ASUpdate* updates = mtmAllocate(&matamazom->allocator,
+	                                (edit->size + 1) * sizeof(*updates));
+	if (updates == NULL) {
+		orderEditAbort(edit);
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	double* deltas = mtmAllocate(&matamazom->allocator,
+	                             (edit->size + 1) * sizeof(*deltas));
+	if (deltas == NULL) {
+		mtmRelease(&matamazom->allocator, updates);
+		orderEditAbort(edit);
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	int count = buildOrderEditUpdates(edit, order, updates, deltas);
+	if (matamazom->reservation_mode) {
+		result = checkOrderEditReservations(edit, updates, deltas, count);
+	}
+	if (result == MATAMAZOM_SUCCESS &&
+	    asApplyUpdates(order->order_products, updates, count) != AS_SUCCESS) {
+		result = MATAMAZOM_OUT_OF_MEMORY;
+	}
+	for (int i = 0; result == MATAMAZOM_SUCCESS &&
+	     matamazom->reservation_mode && i < count; i++) {
+		((Product)updates[i].element)->reserved += deltas[i];
+	}
+	for (int i = 0; result == MATAMAZOM_SUCCESS && i < count; i++) {
+		recordChange(matamazom, MTM_CHANGE_ORDER_LINE_CHANGED,
+		             ((Product)updates[i].element)->product_id,
+		             order->order_id,
+		             updates[i].remove ? 0 : updates[i].amount);
+	}
+	publishChanges(matamazom);
+
+	mtmRelease(&matamazom->allocator, deltas);
+	mtmRelease(&matamazom->allocator, updates);
+	orderEditAbort(edit);
+	return result;
+}
+
+static void orderEditAbort(MtmOrderEdit edit) {
+
+	if (edit == NULL) {
+		return;
+	}
+	const MtmAllocator* allocator = &edit->matamazom->allocator;
+	mtmRelease(allocator, edit->lines);
+	mtmRelease(allocator, edit);
+}
+
+/*
+compareOrderIds - qsort/bsearch compare of unsigned order ids
+*/
+static int compareOrderIds(const void* id1, const void* id2) {
+
+	unsigned int first = *(const unsigned int*)id1;
+	unsigned int second = *(const unsigned int*)id2;
+	return (first > second) - (first < second);
+}
+
+/*
+mergeOrderProducts - adds the products of all sources to target. the lines
+of several sources are sorted by product and folded, in one walk of target,
+into a single update per product, so target is either fully updated or, if
+memory runs out, not changed at all
+INPUT:
+	@param matamazom - the warehouse
+	@param target - order to merge into
+	@param sources - orders to merge
+	@param count - number of sources
+OUTPUT:
+	MATAMAZOM_OUT_OF_MEMORY if allocation failed, else MATAMAZOM_SUCCESS
+*/
+static MatamazomResult mergeOrderProducts(Matamazom matamazom, Order target,
+                                          Order* sources, int count) {
+
+	if (count == 1) {
+		return (asMerge(target->order_products, sources[0]->order_products)
+		        == AS_SUCCESS) ? MATAMAZOM_SUCCESS : MATAMAZOM_OUT_OF_MEMORY;
+	}
+
+	//the source lines as edit lines, seq keeps the sources in list order
+	int size = 0;
+	for (int i = 0; i < count; i++) {
+		size += asGetSize(sources[i]->order_products);
+	}
+	const MtmAllocator* allocator = &matamazom->allocator;
+	OrderEditLine* lines = mtmAllocate(allocator, (size + 1) * sizeof(*lines));
+	ASUpdate* updates = mtmAllocate(allocator, (size + 1) * sizeof(*updates));
+	if (lines == NULL || updates == NULL) {
+		mtmRelease(allocator, lines);
+		mtmRelease(allocator, updates);
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	int line = 0;
+	for (int i = 0; i < count; i++) {
+		AmountSet products = sources[i]->order_products;
+		AS_FOREACH(Product, cur_product, products) {
+			lines[line].product_id = cur_product->product_id;
+			asGetCurrentAmount(products, &lines[line].amount);
+			lines[line].seq = i;
+			lines[line].product = cur_product;
+			line++;
+		}
+	}
+	qsort(lines, size, sizeof(*lines), compareOrderEditLines);
+
+	//sums the sources of every product and adds the amount of target
+	int updates_count = 0;
+	double target_amount = 0;
+	Product target_product = asGetFirst(target->order_products);
+	for (line = 0; line < size;) {
+		unsigned int id = lines[line].product_id;
+		double amount = lines[line++].amount;
+		for (; line < size && lines[line].product_id == id; line++) {
+			amount += lines[line].amount;
+		}
+		while (target_product != NULL && target_product->product_id < id) {
+			target_product = asGetNext(target->order_products);
+		}
+		if (target_product != NULL && target_product->product_id == id) {
+			asGetCurrentAmount(target->order_products, &target_amount);
+			amount = target_amount + amount;
+		}
+		updates[updates_count].element = lines[line - 1].product;
+		updates[updates_count].amount = amount;
+		updates[updates_count].remove = false;
+		updates_count++;
+	}
+
+	MatamazomResult result = (asApplyUpdates(target->order_products, updates,
+	                                         updates_count) == AS_SUCCESS) ?
+	                         MATAMAZOM_SUCCESS : MATAMAZOM_OUT_OF_MEMORY;
+	mtmRelease(allocator, lines);
+	mtmRelease(allocator, updates);
+	return result;
+}
+
+/*
+retireOrders - removes the orders of the given ids in one walk of the order
+list. the list removes only its current element, which ends the walk, so
+the walk first moves the contents of those orders to the head of the list
+(the other orders keep their order) and then they are removed from the head
+INPUT:
+	@param matamazom - the warehouse
+	@param ids - sorted ids of existing orders, not all the orders
+	@param count - number of ids
+	@param heads - room for count orders
+	@param moved - room for 2 * count + 1 order contents
+*/
+static void retireOrders(Matamazom matamazom, const unsigned int* ids,
+                         int count, Order* heads, struct Order_t* moved) {
+
+	//kept contents wait in a ring of count + 1 until their new place is
+	//walked, retired contents are kept after it
+	struct Order_t* pending = moved;
+	struct Order_t* retired = moved + count + 1;
+	int first_pending = 0, pending_size = 0, retired_size = 0, position = 0;
+	LIST_FOREACH(Order, cur_order, matamazom->order_list) {
+		if (bsearch(&cur_order->order_id, ids, count, sizeof(*ids),
+		            compareOrderIds) != NULL) {
+			retired[retired_size++] = *cur_order;
+		} else {
+			pending[(first_pending + pending_size++) % (count + 1)] =
+				*cur_order;
+		}
+		if (position < count) {
+			heads[position++] = cur_order;
+		} else {
+			*cur_order = pending[first_pending];
+			first_pending = (first_pending + 1) % (count + 1);
+			pending_size--;
+		}
+	}
+	assert(retired_size == count && pending_size == 0);
+	for (int i = 0; i < count; i++) {
+		*heads[i] = retired[i];
+	}
+
+	for (int i = 0; i < count; i++) {
+		listGetFirst(matamazom->order_list);
+		listRemoveCurrent(matamazom->order_list);
+	}
+}
+
+//order consolidation with comments on matamazom_ext.h
+
+static MatamazomResult mergeOrders(Matamazom matamazom,
+                                   const unsigned int targetId,
+                                   const unsigned int* sourceIds,
+                                   const int count) {
+
+    if (matamazom == NULL || (sourceIds == NULL && count > 0)) {
+        return MATAMAZOM_NULL_ARGUMENT;
+    }
+    Order target = searchOrderById(matamazom->order_list, targetId);
+    if (target == NULL) {
+        return MATAMAZOM_ORDER_NOT_EXIST;
+    }
+	if (count <= 0) {
+		return MATAMAZOM_SUCCESS;
+	}
+
+	//sorted unique source ids, without the target. the room for retiring
+	//the sources is allocated first, so they cant stay after a merge
+	const MtmAllocator* allocator = &matamazom->allocator;
+	unsigned int* ids = mtmAllocate(allocator, count * sizeof(*ids));
+	Order* sources = mtmAllocate(allocator, count * sizeof(*sources));
+	struct Order_t* moved = mtmAllocate(allocator,
+	                                    (2 * count + 1) * sizeof(*moved));
+	if (ids == NULL || sources == NULL || moved == NULL) {
+		mtmRelease(allocator, ids);
+		mtmRelease(allocator, sources);
+		mtmRelease(allocator, moved);
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	memcpy(ids, sourceIds, count * sizeof(*ids));
+	qsort(ids, count, sizeof(*ids), compareOrderIds);
+	int unique = 0;
+	for (int i = 0; i < count; i++) {
+		if (ids[i] != targetId && (unique == 0 || ids[unique - 1] != ids[i])) {
+			ids[unique++] = ids[i];
+		}
+	}
+
+	//finds all sources in one walk of the order list
+	int found = 0;
+	LIST_FOREACH(Order, cur_order, matamazom->order_list) {
+		if (bsearch(&cur_order->order_id, ids, unique, sizeof(*ids),
+		            compareOrderIds) != NULL) {
+			sources[found++] = cur_order;
+		}
+	}
+
+	MatamazomResult result = (found == unique) ? MATAMAZOM_SUCCESS :
+	                                             MATAMAZOM_ORDER_NOT_EXIST;
+	if (result == MATAMAZOM_SUCCESS && found > 0) {
+		result = mergeOrderProducts(matamazom, target, sources, found);
+	}
+
+	//records the target lines of the source products (several times if
+	//sources share a product), while the sources still exist
+	for (int i = 0; result == MATAMAZOM_SUCCESS &&
+	     matamazom->changes != NULL && i < found; i++) {
+		AS_FOREACH(Product, cur_product, sources[i]->order_products) {
+			recordOrderLine(matamazom, target, cur_product);
+		}
+	}
+
+	//retires the sources, target and sources arent used after it
+	if (result == MATAMAZOM_SUCCESS && unique > 0) {
+		retireOrders(matamazom, ids, unique, sources, moved);
+	}
+	for (int i = 0; result == MATAMAZOM_SUCCESS && i < unique; i++) {
+		recordChange(matamazom, MTM_CHANGE_ORDER_MERGED, 0, ids[i], 0);
+	}
+	publishChanges(matamazom);
+
+	mtmRelease(allocator, ids);
+	mtmRelease(allocator, sources);
+	mtmRelease(allocator, moved);
+	return result;
+}
+
+//range reports with comments on matamazom_ext.h
+
+static MatamazomResult printInventoryRange(Matamazom matamazom,
+                                           const unsigned int lowId,
+                                           const unsigned int highId,
+                                           FILE* output) {
+
+    if (matamazom == NULL || output == NULL) {
+        return MATAMAZOM_NULL_ARGUMENT;
+    }
+
+    //prints headers
+    fprintf(output, "Inventory Status:\n");
+
+    double cur_amount = 0;
+	struct Product_t key_product;
+	key_product.product_id = lowId;
+    //starts at the first product in range and stops after the last one
+    AS_FOREACH_FROM(Product, cur_product, matamazom->products_storage,
+                    &key_product) {
+        if (cur_product->product_id > highId) {
+            break;
+        }
+        asGetCurrentAmount(matamazom->products_storage, &cur_amount);
+        mtmPrintProductDetails(getProductName(cur_product),
+                cur_product->product_id, cur_amount,
+                getProductPrice(cur_product, SINGLE), output);
+    }
+    return MATAMAZOM_SUCCESS;
+}
+
+//name lookups with comments on matamazom_ext.h
+
+static MatamazomResult findProductsByPrefix(Matamazom matamazom,
+                                            const char* prefix,
+                                            MtmProductVisitor visitor,
+                                            void* context) {
+
+	if (matamazom == NULL || prefix == NULL || visitor == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	nameIndexFind(matamazom->name_index, prefix, false, visitor, context);
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult findProductsByName(Matamazom matamazom, const char* name,
+                                          MtmProductVisitor visitor,
+                                          void* context) {
+
+	if (matamazom == NULL || name == NULL || visitor == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	nameIndexFind(matamazom->name_index, name, true, visitor, context);
+	return MATAMAZOM_SUCCESS;
+}
+
+//sales history with comments on matamazom_ext.h
+
+static MatamazomResult getSalesRevenue(Matamazom matamazom,
+                                       const unsigned int lastShipments,
+                                       const unsigned int lowId,
+                                       const unsigned int highId,
+                                       double* outRevenue) {
+
+	if (matamazom == NULL || outRevenue == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	*outRevenue = salesHistoryRevenue(matamazom->sales_history,
+	                                  lastShipments, lowId, highId);
+	return MATAMAZOM_SUCCESS;
+}
+
+//bulk import helpers
+
+/*
+compareImportUpdates - compares the products of two import updates by id,
+for qsort
+INPUT:
+	@param update1 - first update
+	@param update2 - second update
+OUTPUT:
+	< 0 if the first id is smaller, > 0 if bigger, 0 if equal
+*/
+static int compareImportUpdates(const void* update1, const void* update2) {
+	unsigned int id1 = ((Product)((const ASUpdate*)update1)->element)
+		->product_id;
+	unsigned int id2 = ((Product)((const ASUpdate*)update2)->element)
+		->product_id;
+	return (id1 > id2) - (id1 < id2);
+}
+
+/*
+readImportedProducts - reads and validates every record of the reader,
+creating a product for each one
+INPUT:
+	@param matamazom - the warehouse
+	@param reader - reader of the records
+	@param context - passed as is to reader
+	@param buffer - the read products are added to it
+OUTPUT:
+	the mtmNewProduct error of the first invalid record (besides
+	MATAMAZOM_PRODUCT_ALREADY_EXIST), MATAMAZOM_OUT_OF_MEMORY if allocation
+	failed, MATAMAZOM_SUCCESS otherwise
+*/
+static MatamazomResult readImportedProducts(Matamazom matamazom,
+        MtmProductReader reader, void* context, ImportBuffer* buffer) {
+
+	const MtmAllocator* allocator = &matamazom->allocator;
+	MtmProductRecord record;
+	while (reader(context, &record)) {
+		if (record.name == NULL || record.customData == NULL ||
+		    record.copyData == NULL || record.freeData == NULL ||
+		    record.prodPrice == NULL) {
+			return MATAMAZOM_NULL_ARGUMENT;
+		}
+		if (!isValidProductName(record.name)) {
+			return MATAMAZOM_INVALID_NAME;
+		}
+		if (record.amount < 0 || !isAmountConsistentWithAmountType(
+		        record.amount, record.amountType)) {
+			return MATAMAZOM_INVALID_AMOUNT;
+		}
+
+		//grows the buffer when full
+		if (buffer->size == buffer->capacity) {
+			ASUpdate* new_updates = mtmAllocate(allocator,
+			                   2 * buffer->capacity * sizeof(*new_updates));
+			if (new_updates == NULL) {
+				return MATAMAZOM_OUT_OF_MEMORY;
+			}
+			memcpy(new_updates, buffer->updates,
+			       buffer->size * sizeof(*new_updates));
+			mtmRelease(allocator, buffer->updates);
+			buffer->updates = new_updates;
+			buffer->capacity *= 2;
+		}
+
+		Product new_product = createProduct(matamazom, record.id,
+		        record.name, record.amountType, record.customData,
+		        record.copyData, record.freeData, record.prodPrice);
+		if (new_product == NULL) {
+			return MATAMAZOM_OUT_OF_MEMORY;
+		}
+		ASUpdate* update = &buffer->updates[buffer->size++];
+		update->element = new_product;
+		update->amount = record.amount;
+		update->remove = false;
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+/*
+checkImportedIds - sorts the read products by id (if they arent sorted
+already) and checks that no id repeats or is in the storage. the storage
+is walked once, or searched for each product when there are few of them:
+O(min(n, k log n)) for k products and n stored ones
+INPUT:
+	@param matamazom - the warehouse
+	@param buffer - the read products
+OUTPUT:
+	MATAMAZOM_PRODUCT_ALREADY_EXIST - if an id repeats or is in the storage
+	MATAMAZOM_SUCCESS - otherwise
+*/
+static MatamazomResult checkImportedIds(Matamazom matamazom,
+                                        ImportBuffer* buffer) {
+
+	//catalogues usually come sorted, then sorting is skipped
+	for (int i = 1; i < buffer->size; i++) {
+		if (compareImportUpdates(&buffer->updates[i - 1],
+		                         &buffer->updates[i]) > 0) {
+			qsort(buffer->updates, buffer->size, sizeof(*buffer->updates),
+			      compareImportUpdates);
+			break;
+		}
+	}
+	for (int i = 1; i < buffer->size; i++) {
+		if (compareImportUpdates(&buffer->updates[i - 1],
+		                         &buffer->updates[i]) == 0) {
+			return MATAMAZOM_PRODUCT_ALREADY_EXIST;
+		}
+	}
+
+	//few products are searched, the search uses the key directory
+	if (isSmallImport(matamazom, buffer)) {
+		for (int j = 0; j < buffer->size; j++) {
+			if (searchProductById(matamazom->products_storage,
+			        ((Product)buffer->updates[j].element)->product_id) !=
+			    NULL) {
+				return MATAMAZOM_PRODUCT_ALREADY_EXIST;
+			}
+		}
+		return MATAMAZOM_SUCCESS;
+	}
+
+	//walks the storage and the sorted products in parallel
+	int i = 0;
+	AS_FOREACH(Product, cur_product, matamazom->products_storage) {
+		while (i < buffer->size &&
+		       ((Product)buffer->updates[i].element)->product_id <
+		       cur_product->product_id) {
+			i++;
+		}
+		if (i == buffer->size) {
+			break;
+		}
+		if (((Product)buffer->updates[i].element)->product_id ==
+		    cur_product->product_id) {
+			return MATAMAZOM_PRODUCT_ALREADY_EXIST;
+		}
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+/*
+isSmallImport - checks whether the read products are few next to the
+storage, so searching and adding them one by one (k log n for k products
+and n stored ones) is cheaper than walking the storage (n)
+INPUT:
+	@param matamazom - the warehouse
+	@param buffer - the read products
+*/
+static bool isSmallImport(Matamazom matamazom, ImportBuffer* buffer) {
+
+	int size = asGetSize(matamazom->products_storage);
+	int depth = 1;
+	for (int remaining = size; remaining > 1; remaining /= 2) {
+		depth++;
+	}
+	return (long)buffer->size * depth < size;
+}
+
+/*
+storeFewImportedProducts - adds the checked products one by one, as
+mtmNewProduct does, taking the added ones out again if memory runs out
+INPUT:
+	@param matamazom - the warehouse
+	@param buffer - the read products
+OUTPUT:
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed, nothing is added
+	MATAMAZOM_SUCCESS - otherwise
+*/
+static MatamazomResult storeFewImportedProducts(Matamazom matamazom,
+                                                ImportBuffer* buffer) {
+
+	int added = 0;
+	for (; added < buffer->size; added++) {
+		Product cur_product = buffer->updates[added].element;
+		if (!nameIndexInsert(matamazom->name_index,
+		                     getProductName(cur_product),
+		                     cur_product->product_id)) {
+			break;
+		}
+		if (asRegister(matamazom->products_storage, cur_product) !=
+		    AS_SUCCESS) {
+			nameIndexRemove(matamazom->name_index,
+			                getProductName(cur_product),
+			                cur_product->product_id);
+			break;
+		}
+		asChangeAmount(matamazom->products_storage, cur_product,
+		               buffer->updates[added].amount);
+	}
+	if (added == buffer->size) {
+		return MATAMAZOM_SUCCESS;
+	}
+
+	//takes the added products out again, removing doesnt allocate
+	while (added > 0) {
+		Product cur_product = buffer->updates[--added].element;
+		asDelete(matamazom->products_storage, cur_product);
+		nameIndexRemove(matamazom->name_index, getProductName(cur_product),
+		                cur_product->product_id);
+	}
+	return MATAMAZOM_OUT_OF_MEMORY;
+}
+
+/*
+storeImportedProducts - adds the checked products to the storage in one
+ordered walk and to the name index with one sort
+INPUT:
+	@param matamazom - the warehouse
+	@param buffer - the read products, sorted by id
+OUTPUT:
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed, nothing is added
+	MATAMAZOM_SUCCESS - otherwise
+*/
+static MatamazomResult storeImportedProducts(Matamazom matamazom,
+                                             ImportBuffer* buffer) {
+
+	const MtmAllocator* allocator = &matamazom->allocator;
+	NameIndexPair* pairs = mtmAllocate(allocator,
+	                                   buffer->size * sizeof(*pairs));
+	if (pairs == NULL) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	for (int i = 0; i < buffer->size; i++) {
+		Product cur_product = buffer->updates[i].element;
+		pairs[i].name = getProductName(cur_product);
+		pairs[i].id = cur_product->product_id;
+	}
+
+	MatamazomResult result = MATAMAZOM_SUCCESS;
+	if (asApplyUpdates(matamazom->products_storage, buffer->updates,
+	                   buffer->size) != AS_SUCCESS) {
+		result = MATAMAZOM_OUT_OF_MEMORY;
+	}
+	else if (!nameIndexInsertMany(matamazom->name_index, pairs,
+	                              buffer->size)) {
+		//takes the products out again, removing doesnt allocate
+		for (int i = 0; i < buffer->size; i++) {
+			buffer->updates[i].remove = true;
+		}
+		asApplyUpdates(matamazom->products_storage, buffer->updates,
+		               buffer->size);
+		result = MATAMAZOM_OUT_OF_MEMORY;
+	}
+	mtmRelease(allocator, pairs);
+	return result;
+}
+
+//bulk import with comments on matamazom_ext.h
+
+static MatamazomResult importProducts(Matamazom matamazom,
+                                      MtmProductReader reader, void* context) {
+
+	if (matamazom == NULL || reader == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+
+	const MtmAllocator* allocator = &matamazom->allocator;
+	ImportBuffer buffer;
+	buffer.size = 0;
+	buffer.capacity = IMPORT_INITIAL_CAPACITY;
+	buffer.updates = mtmAllocate(allocator,
+	                             buffer.capacity * sizeof(*buffer.updates));
+	if (buffer.updates == NULL) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+
+	MatamazomResult result = readImportedProducts(matamazom, reader, context,
+	                                              &buffer);
+	if (result == MATAMAZOM_SUCCESS) {
+		result = checkImportedIds(matamazom, &buffer);
+	}
+	if (result == MATAMAZOM_SUCCESS && buffer.size > 0) {
+		result = isSmallImport(matamazom, &buffer) ?
+		         storeFewImportedProducts(matamazom, &buffer) :
+		         storeImportedProducts(matamazom, &buffer);
+	}
+	for (int i = 0; result == MATAMAZOM_SUCCESS && i < buffer.size; i++) {
+		recordChange(matamazom, MTM_CHANGE_PRODUCT_ADDED,
+		             ((Product)buffer.updates[i].element)->product_id, 0,
+		             buffer.updates[i].amount);
+		notifyWatch(buffer.updates[i].element, INFINITY,
+		            buffer.updates[i].amount);
+	}
+	publishChanges(matamazom);
+
+	//the storage keeps copies, the read products are freed either way
+	for (int i = 0; i < buffer.size; i++) {
+		freeProduct(buffer.updates[i].element);
+	}
+	mtmRelease(allocator, buffer.updates);
+	return result;
+}
+
+//reservations with comments on matamazom_ext.h
+
+static MatamazomResult setReservationMode(Matamazom matamazom, bool enabled) {
+
+	if (matamazom == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	if (enabled == matamazom->reservation_mode) {
+		return MATAMAZOM_SUCCESS;
+	}
+	if (detachAllProducts(matamazom) != MATAMAZOM_SUCCESS) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	if (enabled) {
+		MatamazomResult result = reserveAllOrders(matamazom);
+		if (result != MATAMAZOM_SUCCESS) {
+			return result;
+		}
+	}
+	else {
+		AS_FOREACH(Product, cur_product, matamazom->products_storage) {
+			cur_product->reserved = 0;
+		}
+	}
+	matamazom->reservation_mode = enabled;
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult getAvailableAmount(Matamazom matamazom,
+                                          const unsigned int productId,
+                                          double* outAmount) {
+
+	if (matamazom == NULL || outAmount == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	Product product = searchProductById(matamazom->products_storage,
+	                                    productId);
+	if (product == NULL) {
+		return MATAMAZOM_PRODUCT_NOT_EXIST;
+	}
+	asGetCurrentAmount(matamazom->products_storage, outAmount);
+	*outAmount -= product->reserved;
+	return MATAMAZOM_SUCCESS;
+}
+
+//watches with comments on matamazom_ext.h
+
+static MatamazomResult watchAmountBelow(Matamazom matamazom,
+                                        const unsigned int productId,
+                                        const double threshold,
+                                        MtmAmountWatcher watcher,
+                                        void* context) {
+
+	if (matamazom == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	if (searchProductById(matamazom->products_storage, productId) == NULL) {
+		return MATAMAZOM_PRODUCT_NOT_EXIST;
+	}
+	Product product = detachProduct(matamazom, productId);
+	if (product == NULL) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	setProductWatch(product, threshold, watcher, context);
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult watchAllAmountsBelow(Matamazom matamazom,
+                                            const double threshold,
+                                            MtmAmountWatcher watcher,
+                                            void* context) {
+
+	if (matamazom == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	if (detachAllProducts(matamazom) != MATAMAZOM_SUCCESS) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	matamazom->default_watcher = watcher;
+	matamazom->default_threshold = threshold;
+	matamazom->default_context = context;
+	AS_FOREACH(Product, cur_product, matamazom->products_storage) {
+		setProductWatch(cur_product, threshold, watcher, context);
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+//memory usage with comments on matamazom_ext.h
+
+/*
+getMemoryEntry - returns the usage entry of a memory counter
+INPUT:
+	@param counter - the counter
+OUTPUT:
+	the entry, with its bytes per element
+*/
+static MtmMemoryEntry getMemoryEntry(const MtmMemoryCounter* counter) {
+	MtmMemoryEntry entry;
+	entry.count = counter->count;
+	entry.bytes = counter->bytes;
+	entry.bytes_per_element = (counter->count == 0) ? 0 :
+	                          (double)counter->bytes / counter->count;
+	return entry;
+}
+
+static MatamazomResult setDataSizeFunction(Matamazom matamazom,
+                                           MtmGetDataSize dataSize) {
+
+	if (matamazom == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	matamazom->memory.dataSize = dataSize;
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult getMemoryUsage(Matamazom matamazom,
+                                      MtmMemoryUsage* usage) {
+
+	if (matamazom == NULL || usage == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	const MtmMemory* memory = &matamazom->memory;
+	usage->nodes = getMemoryEntry(&memory->nodes);
+	usage->products = getMemoryEntry(&memory->products);
+	usage->names = getMemoryEntry(&memory->names);
+	usage->user_data = getMemoryEntry(&memory->user_data);
+	usage->order_headers = getMemoryEntry(&memory->order_headers);
+	usage->order_lines = getMemoryEntry(&memory->order_lines);
+	usage->sales_velocity = getMemoryEntry(&memory->sales_velocity);
+	usage->name_index = getMemoryEntry(&memory->name_index);
+	usage->sales_history = getMemoryEntry(&memory->sales_history);
+	usage->change_feed = getMemoryEntry(&memory->change_feed);
+	usage->total_bytes = usage->nodes.bytes + usage->products.bytes +
+	                     usage->names.bytes + usage->user_data.bytes +
+	                     usage->order_headers.bytes + usage->order_lines.bytes +
+	                     usage->sales_velocity.bytes + usage->name_index.bytes +
+	                     usage->sales_history.bytes +
+	                     usage->change_feed.bytes;
+	return MATAMAZOM_SUCCESS;
+}
+
+//shipping in parts with comments on matamazom_ext.h
+
+static MatamazomResult prepareShipOrder(Matamazom matamazom,
+                                        const unsigned int orderId) {
+
+	if (matamazom == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	Order order = searchOrderById(matamazom->order_list, orderId);
+	if (order == NULL) {
+		return MATAMAZOM_ORDER_NOT_EXIST;
+	}
+	//the checks and allocations of shipOrder, in the same order
+	if (!matamazom->reservation_mode &&
+	    checkInsufficientAmount(matamazom, order) == false) {
+		return MATAMAZOM_INSUFFICIENT_AMOUNT;
+	}
+	if (!salesHistoryReserve(matamazom->sales_history,
+	                         asGetSize(order->order_products)) ||
+	    detachOrderProducts(matamazom, order) != MATAMAZOM_SUCCESS) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult getBestSelling(Matamazom matamazom, unsigned int* outId,
+                                      double* outIncome, const char** outName) {
+
+	if (matamazom == NULL || outId == NULL || outIncome == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	Product best_seller =
+		getBestProfitableProduct(matamazom->products_storage);
+	if (best_seller == NULL) {
+		return MATAMAZOM_PRODUCT_NOT_EXIST;
+	}
+	*outId = best_seller->product_id;
+	*outIncome = getProductPrice(best_seller, best_seller->amount_sold);
+	if (outName != NULL) {
+		*outName = getProductName(best_seller);
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+//snapshots with comments on matamazom_ext.h
+
+static MtmSnapshot snapshotCreate(Matamazom matamazom) {
+
+	if (matamazom == NULL) {
+		return NULL;
+	}
+	MtmSnapshot snapshot = mtmAllocate(&matamazom->allocator,
+	                                   sizeof(*snapshot));
+	if (snapshot == NULL) {
+		return NULL;
+	}
+	snapshot->matamazom = matamazom;
+	snapshot->allocator = &matamazom->allocator;
+#ifdef MATAMAZOM_STATS
+	snapshot->stats = &matamazom->stats;
+#endif
+	snapshot->products = asCopy(matamazom->products_storage);
+	if (snapshot->products == NULL) {
+		mtmRelease(snapshot->allocator, snapshot);
+		return NULL;
+	}
+#ifdef MATAMAZOM_STATS
+	//reports of the snapshot may run in another thread
+	asSetVisitCounter(snapshot->products, NULL);
+#endif
+	matamazom->snapshots++;
+	//reads of the snapshot dont build its directory in the reading thread,
+	//it is the one of the storage unless the storage had none
+	if (asSetReadOnly(snapshot->products) != AS_SUCCESS) {
+		snapshotDestroy(snapshot);
+		return NULL;
+	}
+	return snapshot;
+}
+
+static void snapshotDestroy(MtmSnapshot snapshot) {
+
+	if (snapshot == NULL) {
+		return;
+	}
+	asDestroy(snapshot->products);
+	snapshot->matamazom->snapshots--;
+	mtmRelease(snapshot->allocator, snapshot);
+}
+
+static MatamazomResult snapshotGetProductAmount(MtmSnapshot snapshot,
+                                                const unsigned int productId,
+                                                double* outAmount) {
+
+	if (snapshot == NULL || outAmount == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	if (searchProductById(snapshot->products, productId) == NULL) {
+		return MATAMAZOM_PRODUCT_NOT_EXIST;
+	}
+	asGetCurrentAmount(snapshot->products, outAmount);
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult snapshotPrintInventory(MtmSnapshot snapshot,
+                                              FILE* output) {
+
+	if (snapshot == NULL || output == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	fprintf(output, "Inventory Status:\n");
+	printProductsInAmountSet(snapshot->products, false, output);
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult snapshotPrintBestSelling(MtmSnapshot snapshot,
+                                                FILE* output) {
+
+	if (snapshot == NULL || output == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	printBestSellingProduct(snapshot->products, output);
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult snapshotPrintFiltered(MtmSnapshot snapshot,
+                                             MtmFilterProduct customFilter,
+                                             FILE* output) {
+
+	if (snapshot == NULL || customFilter == NULL || output == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	return printFilteredProducts(snapshot->products, true, customFilter,
+	                             output);
+}
+
+//change feed with comments on matamazom_ext.h
+
+static MatamazomResult enableChangeFeed(Matamazom matamazom, int capacity,
+                                        MtmChangeListener listener, int batch,
+                                        void* context) {
+
+	if (matamazom == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	if (capacity < 0 || capacity > CHANGE_FEED_MAX_CAPACITY ||
+	    (capacity > 0 && listener != NULL &&
+	     (batch <= 0 || batch > capacity))) {
+		return MATAMAZOM_INVALID_AMOUNT;
+	}
+
+	//the new feed is created first, so failing keeps the old one
+	unsigned long last_seq = (matamazom->changes == NULL) ?
+	        matamazom->change_seq : changeFeedLastSeq(matamazom->changes);
+	ChangeFeed feed = NULL;
+	if (capacity > 0) {
+		feed = changeFeedCreate(capacity, last_seq, &matamazom->allocator,
+		                        &matamazom->memory.change_feed);
+		if (feed == NULL) {
+			return MATAMAZOM_OUT_OF_MEMORY;
+		}
+		changeFeedSetListener(feed, listener, batch, context);
+	}
+	if (matamazom->changes != NULL) {
+		changeFeedPublish(matamazom->changes, true);
+		changeFeedDestroy(matamazom->changes);
+	}
+	matamazom->changes = feed;
+	matamazom->change_seq = last_seq;
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult pollChanges(Matamazom matamazom,
+                                   unsigned long afterSeq, MtmChange* changes,
+                                   int max, int* outCount) {
+
+	if (matamazom == NULL || outCount == NULL ||
+	    (changes == NULL && max > 0)) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	*outCount = (matamazom->changes == NULL) ? 0 :
+	            changeFeedRead(matamazom->changes, afterSeq, changes, max);
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult flushChanges(Matamazom matamazom) {
+
+	if (matamazom == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	if (matamazom->changes != NULL) {
+		changeFeedPublish(matamazom->changes, true);
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+//structured queries with comments on matamazom_ext.h
+
+static MatamazomResult queryInventory(Matamazom matamazom,
+                                      const unsigned int* afterId, int limit,
+                                      MtmProductInfo* items, int* outCount) {
+
+	if (matamazom == NULL || outCount == NULL ||
+	    (items == NULL && limit > 0)) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	return queryProducts(matamazom->products_storage, false, afterId, NULL,
+	                     false, limit, items, outCount);
+}
+
+static MatamazomResult queryOrder(Matamazom matamazom,
+                                  const unsigned int orderId,
+                                  const unsigned int* afterId, int limit,
+                                  MtmProductInfo* items, int* outCount) {
+
+	if (matamazom == NULL || outCount == NULL ||
+	    (items == NULL && limit > 0)) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	Order order = searchOrderById(matamazom->order_list, orderId);
+	if (order == NULL) {
+		return MATAMAZOM_ORDER_NOT_EXIST;
+	}
+	return queryProducts(order->order_products, false, afterId, NULL, true,
+	                     limit, items, outCount);
+}
+
+static MatamazomResult queryFiltered(Matamazom matamazom,
+                                     MtmFilterProduct customFilter,
+                                     const unsigned int* afterId, int limit,
+                                     MtmProductInfo* items, int* outCount) {
+
+	if (matamazom == NULL || customFilter == NULL || outCount == NULL ||
+	    (items == NULL && limit > 0)) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	return queryProducts(matamazom->products_storage, false, afterId,
+	                     customFilter, false, limit, items, outCount);
+}
+
+static MatamazomResult snapshotQueryInventory(MtmSnapshot snapshot,
+                                              const unsigned int* afterId,
+                                              int limit,
+                                              MtmProductInfo* items,
+                                              int* outCount) {
+
+	if (snapshot == NULL || outCount == NULL ||
+	    (items == NULL && limit > 0)) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	return queryProducts(snapshot->products, true, afterId, NULL, false,
+	                     limit, items, outCount);
+}
+
+//sales velocity with comments on matamazom_ext.h
+
+static MatamazomResult setSalesVelocityWindow(Matamazom matamazom,
+                                              int intervals) {
+
+	if (matamazom == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	if (intervals < 0) {
+		return MATAMAZOM_INVALID_AMOUNT;
+	}
+	if (detachAllProducts(matamazom) != MATAMAZOM_SUCCESS) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+
+	//creates all the new rings first, so failing changes nothing
+	const MtmAllocator* allocator = &matamazom->allocator;
+	int size = asGetSize(matamazom->products_storage);
+	SalesVelocity* rings = NULL;
+	if (intervals > 0 && size > 0) {
+		rings = mtmAllocate(allocator, size * sizeof(*rings));
+		if (rings == NULL) {
+			return MATAMAZOM_OUT_OF_MEMORY;
+		}
+		for (int i = 0; i < size; i++) {
+			rings[i] = salesVelocityCreate(intervals, matamazom->sales_tick,
+			        allocator, &matamazom->memory.sales_velocity);
+			if (rings[i] == NULL) {
+				while (i > 0) {
+					salesVelocityRelease(rings[--i]);
+				}
+				mtmRelease(allocator, rings);
+				return MATAMAZOM_OUT_OF_MEMORY;
+			}
+		}
+	}
+
+	int ring = 0;
+	AS_FOREACH(Product, cur_product, matamazom->products_storage) {
+		salesVelocityRelease(cur_product->velocity);
+		cur_product->velocity = (rings == NULL) ? NULL : rings[ring++];
+	}
+	mtmRelease(allocator, rings);
+	matamazom->velocity_intervals = intervals;
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult tickSalesInterval(Matamazom matamazom) {
+
+	if (matamazom == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	matamazom->sales_tick++;
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult getSalesVelocity(Matamazom matamazom,
+                                        const unsigned int productId,
+                                        double* outAverage) {
+
+	if (matamazom == NULL || outAverage == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	Product product = searchProductById(matamazom->products_storage,
+	                                    productId);
+	if (product == NULL) {
+		return MATAMAZOM_PRODUCT_NOT_EXIST;
+	}
+	*outAverage = (product->velocity == NULL) ? 0 :
+	              salesVelocityAverage(product->velocity,
+	                                   matamazom->sales_tick);
+	return MATAMAZOM_SUCCESS;
+}
+
+//capacity hints with comments on matamazom_ext.h
+
+Matamazom matamazomCreateWithCapacity(int expectedProducts,
+                                      int expectedShippedLines) {
+
+	Matamazom matamazom = matamazomCreate();
+	if (matamazom != NULL &&
+	    reserveCapacity(matamazom, expectedProducts, expectedShippedLines) !=
+	    MATAMAZOM_SUCCESS) {
+		matamazomDestroy(matamazom);
+		return NULL;
+	}
+	return matamazom;
+}
+
+static MatamazomResult reserveCapacity(Matamazom matamazom,
+                                       int expectedProducts,
+                                       int expectedShippedLines) {
+
+	if (matamazom == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	if (expectedProducts < 0 || expectedShippedLines < 0) {
+		return MATAMAZOM_INVALID_AMOUNT;
+	}
+	int size = asGetSize(matamazom->products_storage);
+	int missing = (expectedProducts > size) ? expectedProducts - size : 0;
+	if (asReserve(matamazom->products_storage, expectedProducts) !=
+	    AS_SUCCESS ||
+	    !nameTableReserve(matamazom->names, expectedProducts) ||
+	    !nameIndexReserve(matamazom->name_index, missing) ||
+	    !salesHistoryReserve(matamazom->sales_history,
+	                         expectedShippedLines)) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+static MatamazomResult reserveOrderLines(Matamazom matamazom,
+                                         const unsigned int orderId,
+                                         int expectedLines) {
+
+	if (matamazom == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	if (expectedLines < 0) {
+		return MATAMAZOM_INVALID_AMOUNT;
+	}
+	Order order = searchOrderById(matamazom->order_list, orderId);
+	if (order == NULL) {
+		return MATAMAZOM_ORDER_NOT_EXIST;
+	}
+	return (asReserve(order->order_products, expectedLines) == AS_SUCCESS) ?
+	       MATAMAZOM_SUCCESS : MATAMAZOM_OUT_OF_MEMORY;
+}
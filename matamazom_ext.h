@@ -0,0 +1,743 @@
+#ifndef MATAMAZOM_EXT_H_
+#define MATAMAZOM_EXT_H_
+#include "matamazom.h"
+#include "mtm_allocator.h"
+#include "change_feed.h"
+
+/*
+extensions of the matamazom interface that arent part of matamazom.h
+*/
+
+/*
+matamazomCreateWithAllocator - same as matamazomCreate, but the warehouse,
+its products, orders and amount sets are allocated with the given allocator.
+note that list nodes of the order list and the products custom data are
+still allocated by list.h and copyData.
+INPUT:
+	@param allocator - allocator to use, copied into the warehouse
+OUTPUT:
+	the new warehouse, NULL if allocator is NULL or out of memory
+*/
+Matamazom matamazomCreateWithAllocator(const MtmAllocator* allocator);
+
+/*
+mtmGetAllocator - returns the allocator of the warehouse, for structures
+that are allocated along with it (e.g. by a ship queue)
+INPUT:
+	@param matamazom - the warehouse
+OUTPUT:
+	the allocator, valid until the warehouse is destroyed. NULL if
+	matamazom is NULL
+*/
+const MtmAllocator* mtmGetAllocator(Matamazom matamazom);
+
+/*
+capacity hints: a warehouse that is about to grow (a catalogue load, a
+flash sale) can reserve for it up front, so the growth doesnt allocate
+nodes one by one or regrow and rehash its tables on the way. reserving
+only allocates ahead, the contents dont change.
+*/
+
+/*
+matamazomCreateWithCapacity - same as matamazomCreate, and reserves room
+as mtmReserveCapacity does. the warehouse uses the default allocator, a
+warehouse with another allocator is created by
+matamazomCreateWithAllocator and reserved by mtmReserveCapacity.
+INPUT:
+	@param expectedProducts - number of products expected
+	@param expectedShippedLines - number of order lines expected to be
+	                              shipped
+OUTPUT:
+	the new warehouse, NULL if a number is negative or out of memory
+*/
+Matamazom matamazomCreateWithCapacity(int expectedProducts,
+                                      int expectedShippedLines);
+
+/*
+mtmReserveCapacity - reserves room for products and shipped orders: the
+storage nodes of the missing products (kept as spares for products that
+are cleared and added again), the key directory of the storage, the
+buckets of the name table, the name index and the sales history records.
+the history keeps a record per line of a shipped order, so an order of n
+lines takes n of them. the list of orders is allocated by list.h and isnt
+reserved. the spare nodes are counted in the bytes of the nodes entry of
+mtmGetMemoryUsage.
+INPUT:
+	@param matamazom - the warehouse
+	@param expectedProducts - number of products expected, spare storage
+	                          nodes above it are freed
+	@param expectedShippedLines - number of order lines expected to be
+	                              shipped, over all the orders
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL
+	MATAMAZOM_INVALID_AMOUNT - if a number is negative
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed, what was reserved is
+	                          kept
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmReserveCapacity(Matamazom matamazom,
+                                   int expectedProducts,
+                                   int expectedShippedLines);
+
+/*
+mtmReserveOrderLines - reserves the nodes of the lines of an order, so
+adding up to expectedLines lines (by mtmChangeProductAmountInOrder, order
+edits or merges) doesnt allocate them. the spare nodes are counted in the
+bytes of the order lines entry of mtmGetMemoryUsage.
+INPUT:
+	@param matamazom - the warehouse
+	@param orderId - id of the order
+	@param expectedLines - number of lines expected
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL
+	MATAMAZOM_INVALID_AMOUNT - if expectedLines is negative
+	MATAMAZOM_ORDER_NOT_EXIST - if the order doesnt exist
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmReserveOrderLines(Matamazom matamazom,
+                                     const unsigned int orderId,
+                                     int expectedLines);
+
+/** Type for defining a batch edit of an order */
+typedef struct MtmOrderEdit_t* MtmOrderEdit;
+
+/*
+mtmOrderEditBegin - opens a batch edit of an order. lines are staged with
+mtmOrderEditStage and applied together by mtmOrderEditCommit.
+INPUT:
+	@param matamazom - warehouse of the order
+	@param orderId - id of the order to edit
+	@param edit - where the new edit is returned
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom or edit are NULL
+	MATAMAZOM_ORDER_NOT_EXIST - if the order doesnt exist
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmOrderEditBegin(Matamazom matamazom,
+                                  const unsigned int orderId,
+                                  MtmOrderEdit* edit);
+
+/*
+mtmOrderEditStage - stages a change of a product amount in the edited
+order, it has the meaning of mtmChangeProductAmountInOrder but nothing is
+validated or changed until the edit is committed
+INPUT:
+	@param edit - the edit
+	@param productId - id of the product
+	@param amount - amount to add to the order (negative to remove)
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if edit is NULL
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmOrderEditStage(MtmOrderEdit edit,
+                                  const unsigned int productId,
+                                  const double amount);
+
+/*
+mtmOrderEditCommit - validates all staged lines and applies them to the
+order at once. the result is the same as calling
+mtmChangeProductAmountInOrder for every staged line in staging order,
+except that if any line is invalid nothing is applied.
+O(k log k + k log n + order lines) for k staged lines and n products.
+the edit is destroyed in any case.
+INPUT:
+	@param edit - the edit
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if edit is NULL
+	MATAMAZOM_ORDER_NOT_EXIST - if the order no longer exists
+	MATAMAZOM_PRODUCT_NOT_EXIST - if a staged product doesnt exist
+	MATAMAZOM_INVALID_AMOUNT - if a staged amount doesnt fit its product
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmOrderEditCommit(MtmOrderEdit edit);
+
+/*
+mtmOrderEditAbort - destroys an edit without applying it
+INPUT:
+	@param edit - the edit, may be NULL
+*/
+void mtmOrderEditAbort(MtmOrderEdit edit);
+
+/*
+mtmMergeOrders - moves the products of the source orders into the target
+order and removes the sources. amounts of the same product are added.
+source ids that repeat or equal the target id are ignored.
+O(orders + l log l) for l lines of the sources: the order list is walked
+once to find the sources and once to remove them.
+INPUT:
+	@param matamazom - the warehouse
+	@param targetId - id of the order that is kept
+	@param sourceIds - ids of the orders that are merged into it
+	@param count - number of source ids
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL, or sourceIds is NULL
+	                          and count is positive
+	MATAMAZOM_ORDER_NOT_EXIST - if the target or a source doesnt exist
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed
+	MATAMAZOM_SUCCESS - otherwise
+	on failure none of the orders is changed.
+*/
+MatamazomResult mtmMergeOrders(Matamazom matamazom,
+                               const unsigned int targetId,
+                               const unsigned int* sourceIds,
+                               const int count);
+
+/*
+mtmPrintInventoryRange - prints the products whose ids are in
+[lowId, highId], in the format of mtmPrintInventory. only the products
+up to the end of the range are visited.
+INPUT:
+	@param matamazom - the warehouse
+	@param lowId - lowest id in range
+	@param highId - highest id in range
+	@param output - open stream to print into
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom or output are NULL
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmPrintInventoryRange(Matamazom matamazom,
+                                       const unsigned int lowId,
+                                       const unsigned int highId,
+                                       FILE* output);
+
+/** Type for defining a visitor of found products, returns false to stop */
+typedef bool (*MtmProductVisitor)(unsigned int productId, const char* name,
+                                  void* context);
+
+/*
+mtmFindProductsByPrefix - visits the products whose name starts with
+prefix, in name order (products with the same name by id).
+O(log n + prefix + results), using the name index of the warehouse.
+INPUT:
+	@param matamazom - the warehouse
+	@param prefix - prefix of the names, "" visits every product
+	@param visitor - called for every product found until it returns false
+	@param context - passed as is to visitor
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom, prefix or visitor are NULL
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmFindProductsByPrefix(Matamazom matamazom,
+                                        const char* prefix,
+                                        MtmProductVisitor visitor,
+                                        void* context);
+
+/*
+mtmFindProductsByName - same as mtmFindProductsByPrefix, but visits only
+the products whose name equals name
+*/
+MatamazomResult mtmFindProductsByName(Matamazom matamazom, const char* name,
+                                      MtmProductVisitor visitor,
+                                      void* context);
+
+/*
+mtmGetSalesRevenue - returns the revenue of the shipped products whose ids
+are in [lowId, highId], over the last shipments. shipped orders are kept
+in a compact history, this only walks the records of those shipments.
+INPUT:
+	@param matamazom - the warehouse
+	@param lastShipments - number of last shipped orders, 0 for all of them
+	@param lowId - lowest product id in range (highId too for one product)
+	@param highId - highest product id in range
+	@param outRevenue - where the revenue is returned
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom or outRevenue are NULL
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmGetSalesRevenue(Matamazom matamazom,
+                                   const unsigned int lastShipments,
+                                   const unsigned int lowId,
+                                   const unsigned int highId,
+                                   double* outRevenue);
+
+/** Type for defining a product record of mtmImportProducts */
+typedef struct MtmProductRecord_t {
+	unsigned int id;
+	const char* name;//only needs to be valid until the next read
+	double amount;
+	MatamazomAmountType amountType;
+	MtmProductData customData;//copied with copyData
+	MtmCopyData copyData;
+	MtmFreeData freeData;
+	MtmGetProductPrice prodPrice;
+} MtmProductRecord;
+
+/*
+Type for defining a reader of product records (e.g. a parser of a
+catalogue file). fills record with the next record and returns true,
+returns false when there are no more records.
+*/
+typedef bool (*MtmProductReader)(void* context, MtmProductRecord* record);
+
+/*
+mtmImportProducts - adds every product read by reader to the warehouse,
+as if by mtmNewProduct, in O(n log n) for n read products (O(n) when
+they are read sorted by id) plus one walk of the storage. when they are
+few next to the storage, they are searched and added one by one instead.
+either all the products are added or none of them.
+INPUT:
+	@param matamazom - the warehouse
+	@param reader - reader of the records
+	@param context - passed as is to reader
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom or reader are NULL, or a record
+	                          has a NULL field
+	MATAMAZOM_INVALID_NAME - if a record has an invalid name
+	MATAMAZOM_INVALID_AMOUNT - if a record has an invalid amount
+	MATAMAZOM_PRODUCT_ALREADY_EXIST - if an id repeats or is in the
+	                                  warehouse
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed
+	MATAMAZOM_SUCCESS - otherwise
+	reading stops at the first invalid record.
+*/
+MatamazomResult mtmImportProducts(Matamazom matamazom,
+                                  MtmProductReader reader, void* context);
+
+/*
+mtmSetReservationMode - turns reservation mode on or off. in reservation
+mode every order holds the stock of its lines: adding to an order line
+fails with MATAMAZOM_INSUFFICIENT_AMOUNT unless the unreserved stock
+covers it (also for mtmOrderEditCommit), cancelling an order releases its
+stock, mtmChangeProductAmount cant take reserved stock out and
+mtmShipOrder commits the reserved amounts without checking the stock.
+INPUT:
+	@param matamazom - the warehouse
+	@param enabled - true to turn the mode on
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL
+	MATAMAZOM_INSUFFICIENT_AMOUNT - if turning on and the existing orders
+	                                need more than the stock of a product,
+	                                the mode stays off
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmSetReservationMode(Matamazom matamazom, bool enabled);
+
+/*
+mtmGetAvailableAmount - returns the stock of a product that isnt reserved
+by orders (all of its stock when reservation mode is off)
+INPUT:
+	@param matamazom - the warehouse
+	@param productId - id of the product
+	@param outAmount - where the amount is returned
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom or outAmount are NULL
+	MATAMAZOM_PRODUCT_NOT_EXIST - if the product doesnt exist
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmGetAvailableAmount(Matamazom matamazom,
+                                      const unsigned int productId,
+                                      double* outAmount);
+
+/*
+Type for defining a watcher of a product amount. it may change amounts in
+the warehouse, but must not ship, cancel or clear anything.
+*/
+typedef void (*MtmAmountWatcher)(unsigned int productId, double amount,
+                                 double threshold, void* context);
+
+/*
+mtmWatchAmountBelow - sets the watch of a product: watcher is called
+whenever mtmChangeProductAmount or mtmShipOrder takes the amount of the
+product from threshold or more to below it. checked in O(1) per change.
+a product has one watch, setting it replaces the previous one.
+INPUT:
+	@param matamazom - the warehouse
+	@param productId - id of the product
+	@param threshold - the threshold
+	@param watcher - called when the amount drops below threshold, NULL to
+	                 remove the watch
+	@param context - passed as is to watcher
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL
+	MATAMAZOM_PRODUCT_NOT_EXIST - if the product doesnt exist
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmWatchAmountBelow(Matamazom matamazom,
+                                    const unsigned int productId,
+                                    const double threshold,
+                                    MtmAmountWatcher watcher,
+                                    void* context);
+
+/*
+mtmWatchAllAmountsBelow - sets the watch of every product, like
+mtmWatchAmountBelow, and makes it the watch of new products. new products
+(mtmNewProduct, mtmImportProducts) created below the threshold are
+reported at once.
+INPUT:
+	@param matamazom - the warehouse
+	@param threshold - the threshold
+	@param watcher - the watcher, NULL to remove all the watches
+	@param context - passed as is to watcher
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmWatchAllAmountsBelow(Matamazom matamazom,
+                                        const double threshold,
+                                        MtmAmountWatcher watcher,
+                                        void* context);
+
+/** Type for defining a function returning the size of product data */
+typedef size_t (*MtmGetDataSize)(MtmProductData);
+
+/*
+mtmSetDataSizeFunction - sets the function used to count the memory of
+the additional data of products. data copied afterwards is sized by it,
+data copied before counts as 0 bytes.
+INPUT:
+	@param matamazom - the warehouse
+	@param dataSize - size function, NULL to stop sizing data
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmSetDataSizeFunction(Matamazom matamazom,
+                                       MtmGetDataSize dataSize);
+
+/** Type for defining the memory usage of one kind of element */
+typedef struct MtmMemoryEntry_t {
+	size_t count;//live elements
+	size_t bytes;//bytes allocated for them
+	double bytes_per_element;//0 if there are no elements
+} MtmMemoryEntry;
+
+/** Type for defining the memory usage of a warehouse */
+typedef struct MtmMemoryUsage_t {
+	MtmMemoryEntry nodes;//storage nodes, and the storage key directory and
+	                     //spare nodes in the bytes
+	MtmMemoryEntry products;//product records of the storage
+	MtmMemoryEntry names;//interned long names, and the name table buckets
+	MtmMemoryEntry user_data;//additional data copies, by the size function
+	MtmMemoryEntry order_headers;//order records
+	MtmMemoryEntry order_lines;//order lines: nodes of the order products,
+	                           //and their product records and spare
+	                           //nodes in the bytes
+	MtmMemoryEntry sales_velocity;//sales velocity rings
+	MtmMemoryEntry name_index;//pairs of the name index, and its array
+	MtmMemoryEntry sales_history;//records of the sales history, and its
+	                             //chunks (reserved ones too) in the bytes
+	MtmMemoryEntry change_feed;//slots of the change feed ring, used or not
+	size_t total_bytes;//sum of the entries
+} MtmMemoryUsage;
+
+/*
+mtmGetMemoryUsage - returns the memory used by the warehouse, by kind of
+element. O(1), read from counters kept by the allocation paths.
+copy on write copies are counted once and short names are part of the
+product records. the nodes of the order list (allocated by list.h) and
+the structs of the warehouse and its tables arent counted.
+INPUT:
+	@param matamazom - the warehouse
+	@param usage - where the usage is returned
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if one of the args is NULL
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmGetMemoryUsage(Matamazom matamazom, MtmMemoryUsage* usage);
+
+/*
+mtmPrepareShipOrder - checks that an order can be shipped and reserves
+what shipping it needs, so mtmShipOrder of it cant fail as long as the
+warehouse doesnt change in between. used to ship orders of several
+warehouses as one operation
+INPUT:
+	@param matamazom - the warehouse
+	@param orderId - id of the order
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL
+	MATAMAZOM_ORDER_NOT_EXIST - if the order doesnt exist
+	MATAMAZOM_INSUFFICIENT_AMOUNT - if the order has more of a product than
+	                                the warehouse
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmPrepareShipOrder(Matamazom matamazom,
+                                    const unsigned int orderId);
+
+/*
+mtmGetBestSelling - returns the product reported by mtmPrintBestSelling
+INPUT:
+	@param matamazom - the warehouse
+	@param outId - where the id of the product is returned
+	@param outIncome - where its income is returned
+	@param outName - where its name is returned, may be NULL. the name is
+	                 valid until the product is cleared
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom, outId or outIncome are NULL
+	MATAMAZOM_PRODUCT_NOT_EXIST - if nothing was sold (reported as none)
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmGetBestSelling(Matamazom matamazom, unsigned int* outId,
+                                  double* outIncome, const char** outName);
+
+/*
+sales velocity: with a window of intervals set, every product keeps the
+amounts it sold in the last intervals and their running sum, updated by
+the shipping of orders. the intervals are advanced by the caller (e.g.
+hourly) with mtmTickSalesInterval.
+*/
+
+/*
+mtmSetSalesVelocityWindow - sets the number of intervals the velocity is
+averaged over. the sales recorded so far are dropped.
+INPUT:
+	@param matamazom - the warehouse
+	@param intervals - number of intervals, 0 to stop recording velocity
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL
+	MATAMAZOM_INVALID_AMOUNT - if intervals is negative
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed, nothing is changed
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmSetSalesVelocityWindow(Matamazom matamazom,
+                                          int intervals);
+
+/*
+mtmTickSalesInterval - starts the next sales interval, O(1). the products
+catch up with it when they are sold or queried.
+INPUT:
+	@param matamazom - the warehouse
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmTickSalesInterval(Matamazom matamazom);
+
+/*
+mtmGetSalesVelocity - returns the moving average of the amount of a
+product shipped per interval, over the window of intervals (the current
+interval included). O(log n) to find the product, plus the intervals
+passed since its last sale, at most the window
+INPUT:
+	@param matamazom - the warehouse
+	@param productId - id of the product
+	@param outAverage - where the average is returned, 0 while no window
+	                    is set
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom or outAverage are NULL
+	MATAMAZOM_PRODUCT_NOT_EXIST - if the product doesnt exist
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmGetSalesVelocity(Matamazom matamazom,
+                                    const unsigned int productId,
+                                    double* outAverage);
+
+/*
+structured queries: the read reports, as pages of records instead of
+text. a page starts after the id of the last record of the previous page,
+so page N is found in O(log n) without walking the pages before it.
+a page with less than limit records is the last one. the best selling
+product is returned by mtmGetBestSelling.
+*/
+
+/** Type for defining a product record of a query */
+typedef struct MtmProductInfo_t {
+	unsigned int id;
+	const char* name;//owned by the warehouse, valid until it changes
+	double amount;
+	double price;//price of a unit, of the amount for order lines
+} MtmProductInfo;
+
+/*
+mtmQueryInventory - returns a page of the products of the warehouse, in id
+order, with the values mtmPrintInventory prints. O(log n + limit)
+INPUT:
+	@param matamazom - the warehouse
+	@param afterId - id of the last product of the previous page, NULL for
+	                 the first page
+	@param limit - room in items
+	@param items - where the products are returned
+	@param outCount - where the number of returned products is returned
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom or outCount are NULL, or items
+	                          is NULL and limit is positive
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmQueryInventory(Matamazom matamazom,
+                                  const unsigned int* afterId, int limit,
+                                  MtmProductInfo* items, int* outCount);
+
+/*
+mtmQueryOrder - same as mtmQueryInventory, for the lines of an order, with
+the values mtmPrintOrder prints (the price is of the line amount)
+INPUT:
+	@param matamazom - the warehouse
+	@param orderId - id of the order
+	@param afterId - id of the last product of the previous page, or NULL
+	@param limit - room in items
+	@param items - where the lines are returned
+	@param outCount - where the number of returned lines is returned
+OUTPUT:
+	same as mtmQueryInventory, and
+	MATAMAZOM_ORDER_NOT_EXIST - if the order doesnt exist
+*/
+MatamazomResult mtmQueryOrder(Matamazom matamazom,
+                              const unsigned int orderId,
+                              const unsigned int* afterId, int limit,
+                              MtmProductInfo* items, int* outCount);
+
+/*
+mtmQueryFiltered - same as mtmQueryInventory, for the products accepted by
+customFilter, like mtmPrintFiltered. O(log n + products walked until the
+page is full). products that customFilter clears arent returned.
+INPUT:
+	@param matamazom - the warehouse
+	@param customFilter - the filter
+	@param afterId - id of the last product of the previous page, or NULL
+	@param limit - room in items
+	@param items - where the products are returned
+	@param outCount - where the number of returned products is returned
+OUTPUT:
+	same as mtmQueryInventory, MATAMAZOM_NULL_ARGUMENT also if customFilter
+	is NULL
+*/
+MatamazomResult mtmQueryFiltered(Matamazom matamazom,
+                                 MtmFilterProduct customFilter,
+                                 const unsigned int* afterId, int limit,
+                                 MtmProductInfo* items, int* outCount);
+
+/*
+snapshots are immutable views of the products of a warehouse and their
+amounts. creating one shares the storage copy on write, nodes, key
+directory and product records. the first change of the warehouse after it
+copies the storage nodes for the warehouse, not the products: a product
+record is copied only when the warehouse changes it, so while a snapshot
+is alive, changes of the warehouse may fail with MATAMAZOM_OUT_OF_MEMORY.
+reading a snapshot doesnt allocate or count memory of the warehouse.
+creating and destroying a snapshot are changes of the warehouse (e.g.
+done under mtmShipQueueLock), reading it isnt: its reports may run in
+another thread while the warehouse keeps changing. a snapshot is read by
+one thread at a time and must be destroyed before its warehouse.
+*/
+
+/** Type for defining a snapshot of a warehouse */
+typedef struct MtmSnapshot_t* MtmSnapshot;
+
+/*
+mtmSnapshotCreate - creates a snapshot of the products of the warehouse.
+O(1) if the warehouse has its key directory, else O(n) once to build it
+INPUT:
+	@param matamazom - the warehouse
+OUTPUT:
+	the snapshot, NULL if matamazom is NULL or out of memory
+*/
+MtmSnapshot mtmSnapshotCreate(Matamazom matamazom);
+
+/*
+mtmSnapshotDestroy - destroys a snapshot. O(1), unless the warehouse
+changed since it was created, then the nodes of the snapshot are freed and
+only the products the warehouse replaced or removed since
+INPUT:
+	@param snapshot - snapshot to destroy, may be NULL
+*/
+void mtmSnapshotDestroy(MtmSnapshot snapshot);
+
+/*
+mtmSnapshotGetProductAmount - returns the amount a product had
+INPUT:
+	@param snapshot - the snapshot
+	@param productId - id of the product
+	@param outAmount - where the amount is returned
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if snapshot or outAmount are NULL
+	MATAMAZOM_PRODUCT_NOT_EXIST - if the product didnt exist
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmSnapshotGetProductAmount(MtmSnapshot snapshot,
+                                            const unsigned int productId,
+                                            double* outAmount);
+
+/*
+mtmSnapshotPrintInventory, mtmSnapshotPrintBestSelling,
+mtmSnapshotPrintFiltered - same as mtmPrintInventory, mtmPrintBestSelling
+and mtmPrintFiltered, for the products of the snapshot. customFilter must
+not use the warehouse or the snapshot.
+*/
+MatamazomResult mtmSnapshotPrintInventory(MtmSnapshot snapshot,
+                                          FILE* output);
+MatamazomResult mtmSnapshotPrintBestSelling(MtmSnapshot snapshot,
+                                            FILE* output);
+MatamazomResult mtmSnapshotPrintFiltered(MtmSnapshot snapshot,
+                                         MtmFilterProduct customFilter,
+                                         FILE* output);
+
+/*
+mtmSnapshotQueryInventory - same as mtmQueryInventory, for the products of
+the snapshot. the names stay valid while the snapshot is alive, so pages
+of it are consistent with each other.
+*/
+MatamazomResult mtmSnapshotQueryInventory(MtmSnapshot snapshot,
+                                          const unsigned int* afterId,
+                                          int limit, MtmProductInfo* items,
+                                          int* outCount);
+
+/*
+change feed: when enabled, every change of the products and orders of the
+warehouse is recorded in a ring of MtmChange records (see change_feed.h),
+so mirrors of the warehouse follow it without reading all of it. stock
+reservations arent recorded, they follow from the orders. a mirror polls
+the changes after the last sequence number it applied, or gets them from
+a listener in batches, at the end of the call that made them.
+*/
+
+/*
+mtmEnableChangeFeed - enables, replaces or disables the change feed. the
+changes of the previous feed are flushed to its listener and dropped,
+sequence numbers continue from it.
+INPUT:
+	@param matamazom - the warehouse
+	@param capacity - number of changes kept, rounded up to a power of 2,
+	                  0 to disable the feed
+	@param listener - called with batches of changes, NULL for none. it
+	                  must not change the warehouse
+	@param batch - number of changes delivered together, 1 to capacity.
+	               a call that makes more than capacity changes delivers
+	               only the last of them
+	@param context - passed as is to listener
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL
+	MATAMAZOM_INVALID_AMOUNT - if capacity is negative or too big, or
+	                           batch is out of range with a listener
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed, the feed isnt changed
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmEnableChangeFeed(Matamazom matamazom, int capacity,
+                                    MtmChangeListener listener, int batch,
+                                    void* context);
+
+/*
+mtmPollChanges - copies the oldest changes after a sequence number that
+the feed still keeps, O(number of changes copied)
+INPUT:
+	@param matamazom - the warehouse
+	@param afterSeq - last sequence number the mirror applied, 0 at first
+	@param changes - where the changes are copied to
+	@param max - room in changes
+	@param outCount - where the number of copied changes is returned. if
+	                  the first of them isnt afterSeq + 1, changes were
+	                  overwritten and the mirror must be rebuilt
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom or outCount are NULL, or
+	                          changes is NULL and max is positive
+	MATAMAZOM_SUCCESS - otherwise (no changes while the feed is disabled)
+*/
+MatamazomResult mtmPollChanges(Matamazom matamazom, unsigned long afterSeq,
+                               MtmChange* changes, int max, int* outCount);
+
+/*
+mtmFlushChanges - delivers the changes the listener didnt get yet, also
+if there are less than batch of them
+INPUT:
+	@param matamazom - the warehouse
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if matamazom is NULL
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmFlushChanges(Matamazom matamazom);
+
+#endif //MATAMAZOM_EXT_H_
@@ -0,0 +1,159 @@
+#define _POSIX_C_SOURCE 199309L
+#include "matamazom_stats.h"
+#include <assert.h>
+#include <time.h>
+
+#define NS_IN_SEC 1000000000.0
+
+static const char* api_names[MTM_STATS_API_COUNT] = {
+	"mtmNewProduct",
+	"mtmChangeProductAmount",
+	"mtmClearProduct",
+	"mtmCreateNewOrder",
+	"mtmChangeProductAmountInOrder",
+	"mtmShipOrder",
+	"mtmCancelOrder",
+	"mtmPrintInventory",
+	"mtmPrintOrder",
+	"mtmPrintBestSelling",
+	"mtmPrintFiltered",
+	"mtmOrderEditBegin",
+	"mtmOrderEditStage",
+	"mtmOrderEditCommit",
+	"mtmMergeOrders",
+	"mtmPrintInventoryRange",
+	"mtmFindProductsByPrefix",
+	"mtmFindProductsByName",
+	"mtmGetSalesRevenue",
+	"mtmImportProducts",
+	"mtmShipOrderAsync",
+	"mtmSetReservationMode",
+	"mtmGetAvailableAmount",
+	"mtmWatchAmountBelow",
+	"mtmWatchAllAmountsBelow",
+	"mtmSetDataSizeFunction",
+	"mtmGetMemoryUsage",
+	"mtmSnapshotCreate",
+	"mtmSnapshotDestroy",
+	"mtmSnapshotGetProductAmount",
+	"mtmSnapshotPrintInventory",
+	"mtmSnapshotPrintBestSelling",
+	"mtmSnapshotPrintFiltered",
+	"mtmPrepareShipOrder",
+	"mtmGetBestSelling",
+	"mtmEnableChangeFeed",
+	"mtmPollChanges",
+	"mtmFlushChanges",
+	"mtmQueryInventory",
+	"mtmQueryOrder",
+	"mtmQueryFiltered",
+	"mtmSnapshotQueryInventory",
+	"mtmSetSalesVelocityWindow",
+	"mtmTickSalesInterval",
+	"mtmGetSalesVelocity",
+	"mtmReserveCapacity",
+	"mtmReserveOrderLines",
+	"mtmOrderEditAbort",
+	"mtmGetAllocator",
+	"mtmShipQueueCreate",
+	"mtmShipQueueDestroy",
+	"mtmShipQueueLock",
+	"mtmShipQueueUnlock"
+};
+
+static const char* result_names[MTM_STATS_RESULTS] = {
+	"MATAMAZOM_SUCCESS",
+	"MATAMAZOM_NULL_ARGUMENT",
+	"MATAMAZOM_OUT_OF_MEMORY",
+	"MATAMAZOM_INVALID_NAME",
+	"MATAMAZOM_INVALID_AMOUNT",
+	"MATAMAZOM_PRODUCT_ALREADY_EXIST",
+	"MATAMAZOM_PRODUCT_NOT_EXIST",
+	"MATAMAZOM_ORDER_NOT_EXIST",
+	"MATAMAZOM_INSUFFICIENT_AMOUNT"
+};
+
+/*
+getLatencyBucket - returns the log2 bucket of a latency
+INPUT:
+	@param latency - latency in nanoseconds
+OUTPUT:
+	floor(log2(latency)), capped to the last bucket
+*/
+static int getLatencyBucket(double latency) {
+
+	unsigned long nanoseconds = (latency < 1) ? 1 : (unsigned long)latency;
+	int bucket = 0;
+	while (nanoseconds > 1 && bucket < MTM_STATS_BUCKETS - 1) {
+		nanoseconds >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+double mtmStatsNow() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * NS_IN_SEC + now.tv_nsec;
+}
+
+void mtmStatsRecord(MatamazomStats* stats, MtmStatsApi api,
+                    MatamazomResult result, double start) {
+
+	if (stats == NULL) {
+		return;
+	}
+	assert(api < MTM_STATS_API_COUNT && result < MTM_STATS_RESULTS);
+
+	MtmApiStats* api_stats = &stats->apis[api];
+	int bucket = getLatencyBucket(mtmStatsNow() - start);
+	__atomic_fetch_add(&api_stats->calls, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&api_stats->results[result], 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&api_stats->latency[bucket], 1, __ATOMIC_RELAXED);
+}
+
+void mtmStatsPrint(const MatamazomStats* stats, FILE* output) {
+
+	assert(stats != NULL && output != NULL);
+
+	fprintf(output, "Matamazom Stats:\n");
+	for (int api = 0; api < MTM_STATS_API_COUNT; api++) {
+		const MtmApiStats* api_stats = &stats->apis[api];
+		if (api_stats->calls == 0) {
+			continue;
+		}
+		fprintf(output, "%s: calls %lu, errors:", api_names[api],
+		        api_stats->calls);
+		unsigned long errors = 0;
+		for (int result = MATAMAZOM_SUCCESS + 1; result < MTM_STATS_RESULTS;
+		     result++) {
+			if (api_stats->results[result] != 0) {
+				fprintf(output, " %s %lu", result_names[result],
+				        api_stats->results[result]);
+				errors += api_stats->results[result];
+			}
+		}
+		if (errors == 0) {
+			fprintf(output, " none");
+		}
+		fprintf(output, "\n\tlatency(ns):");
+		for (int bucket = 0; bucket < MTM_STATS_BUCKETS; bucket++) {
+			if (api_stats->latency[bucket] == 0) {
+				continue;
+			}
+			//the first bucket starts at 0, the last one has no end
+			fprintf(output, " [%llu,", (bucket == 0) ? 0ULL : 1ULL << bucket);
+			if (bucket == MTM_STATS_BUCKETS - 1) {
+				fprintf(output, "inf)");
+			}
+			else {
+				fprintf(output, "%llu)", 1ULL << (bucket + 1));
+			}
+			fprintf(output, ":%lu", api_stats->latency[bucket]);
+		}
+		fprintf(output, "\n");
+	}
+	fprintf(output, "nodes visited: %lu\n", stats->nodes_visited);
+	fprintf(output, "prodPrice calls: %lu\n", stats->price_calls);
+	fprintf(output, "copyData calls: %lu\n", stats->copy_data_calls);
+}
@@ -0,0 +1,152 @@
+#ifndef MATAMAZOM_STATS_H_
+#define MATAMAZOM_STATS_H_
+#include <stdio.h>
+#include "matamazom.h"
+
+/*
+optional instrumentation of the matamazom api.
+compile with -DMATAMAZOM_STATS to enable it, otherwise the counters arent
+kept at all and mtmGetStats/mtmDumpStats report empty stats.
+*/
+
+//number of MatamazomResult codes
+#define MTM_STATS_RESULTS (MATAMAZOM_INSUFFICIENT_AMOUNT + 1)
+//latency bucket i counts calls that took [2^i, 2^(i+1)) nanoseconds,
+//except the first one [0, 2) and the last one [2^31, inf)
+#define MTM_STATS_BUCKETS 32
+
+/** Type for defining the instrumented entry points */
+typedef enum MtmStatsApi_t {
+	MTM_STATS_NEW_PRODUCT,
+	MTM_STATS_CHANGE_PRODUCT_AMOUNT,
+	MTM_STATS_CLEAR_PRODUCT,
+	MTM_STATS_CREATE_NEW_ORDER,
+	MTM_STATS_CHANGE_PRODUCT_AMOUNT_IN_ORDER,
+	MTM_STATS_SHIP_ORDER,
+	MTM_STATS_CANCEL_ORDER,
+	MTM_STATS_PRINT_INVENTORY,
+	MTM_STATS_PRINT_ORDER,
+	MTM_STATS_PRINT_BEST_SELLING,
+	MTM_STATS_PRINT_FILTERED,
+	MTM_STATS_ORDER_EDIT_BEGIN,
+	MTM_STATS_ORDER_EDIT_STAGE,
+	MTM_STATS_ORDER_EDIT_COMMIT,
+	MTM_STATS_MERGE_ORDERS,
+	MTM_STATS_PRINT_INVENTORY_RANGE,
+	MTM_STATS_FIND_PRODUCTS_BY_PREFIX,
+	MTM_STATS_FIND_PRODUCTS_BY_NAME,
+	MTM_STATS_GET_SALES_REVENUE,
+	MTM_STATS_IMPORT_PRODUCTS,
+	MTM_STATS_SHIP_ORDER_ASYNC,
+	MTM_STATS_SET_RESERVATION_MODE,
+	MTM_STATS_GET_AVAILABLE_AMOUNT,
+	MTM_STATS_WATCH_AMOUNT_BELOW,
+	MTM_STATS_WATCH_ALL_AMOUNTS_BELOW,
+	MTM_STATS_SET_DATA_SIZE_FUNCTION,
+	MTM_STATS_GET_MEMORY_USAGE,
+	MTM_STATS_SNAPSHOT_CREATE,
+	MTM_STATS_SNAPSHOT_DESTROY,
+	MTM_STATS_SNAPSHOT_GET_PRODUCT_AMOUNT,
+	MTM_STATS_SNAPSHOT_PRINT_INVENTORY,
+	MTM_STATS_SNAPSHOT_PRINT_BEST_SELLING,
+	MTM_STATS_SNAPSHOT_PRINT_FILTERED,
+	MTM_STATS_PREPARE_SHIP_ORDER,
+	MTM_STATS_GET_BEST_SELLING,
+	MTM_STATS_ENABLE_CHANGE_FEED,
+	MTM_STATS_POLL_CHANGES,
+	MTM_STATS_FLUSH_CHANGES,
+	MTM_STATS_QUERY_INVENTORY,
+	MTM_STATS_QUERY_ORDER,
+	MTM_STATS_QUERY_FILTERED,
+	MTM_STATS_SNAPSHOT_QUERY_INVENTORY,
+	MTM_STATS_SET_SALES_VELOCITY_WINDOW,
+	MTM_STATS_TICK_SALES_INTERVAL,
+	MTM_STATS_GET_SALES_VELOCITY,
+	MTM_STATS_RESERVE_CAPACITY,
+	MTM_STATS_RESERVE_ORDER_LINES,
+	MTM_STATS_ORDER_EDIT_ABORT,
+	MTM_STATS_GET_ALLOCATOR,
+	MTM_STATS_SHIP_QUEUE_CREATE,
+	MTM_STATS_SHIP_QUEUE_DESTROY,
+	MTM_STATS_SHIP_QUEUE_LOCK,
+	MTM_STATS_SHIP_QUEUE_UNLOCK,
+	MTM_STATS_API_COUNT
+} MtmStatsApi;
+
+/** Type for defining the counters of a single entry point */
+typedef struct MtmApiStats_t {
+	unsigned long calls;//number of calls
+	unsigned long results[MTM_STATS_RESULTS];//calls per returned result
+	unsigned long latency[MTM_STATS_BUCKETS];//log bucketed latency
+} MtmApiStats;
+
+/** Type for defining the counters of a warehouse */
+typedef struct MatamazomStats_t {
+	MtmApiStats apis[MTM_STATS_API_COUNT];
+	unsigned long nodes_visited;//nodes visited by amount set searches
+	unsigned long price_calls;//prodPrice invocations
+	unsigned long copy_data_calls;//copyData invocations
+} MatamazomStats;
+
+/*
+mtmGetStats - copies the counters of the warehouse
+INPUT:
+	@param matamazom - warehouse to query
+	@param stats - where the counters are copied to
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if one of the args is NULL
+	MATAMAZOM_SUCCESS - otherwise (zeroed stats when compiled out)
+*/
+MatamazomResult mtmGetStats(Matamazom matamazom, MatamazomStats* stats);
+
+/*
+mtmDumpStats - prints the counters of the warehouse
+INPUT:
+	@param matamazom - warehouse to query
+	@param output - open stream to print into
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if one of the args is NULL
+	MATAMAZOM_SUCCESS - otherwise
+*/
+MatamazomResult mtmDumpStats(Matamazom matamazom, FILE* output);
+
+/*
+mtmStatsNow - returns a monotonic timestamp in nanoseconds
+*/
+double mtmStatsNow();
+
+/*
+mtmStatsRecord - records a finished call of an entry point. the counters
+are updated atomically, so calls that run in other threads (ship queue
+producers) can record at the same time
+INPUT:
+	@param stats - counters to update
+	@param api - the entry point that was called
+	@param result - result of the call
+	@param start - timestamp taken by mtmStatsNow when the call started
+*/
+void mtmStatsRecord(MatamazomStats* stats, MtmStatsApi api,
+                    MatamazomResult result, double start);
+
+/*
+mtmStatsRecordCall - records a finished call of an entry point that is
+implemented outside matamazom.c, in the counters of its warehouse. does
+nothing when compiled without MATAMAZOM_STATS
+INPUT:
+	@param matamazom - warehouse of the call, NULL records nothing
+	@param api - the entry point that was called
+	@param result - result of the call
+	@param start - timestamp taken by mtmStatsNow when the call started
+*/
+void mtmStatsRecordCall(Matamazom matamazom, MtmStatsApi api,
+                        MatamazomResult result, double start);
+
+/*
+mtmStatsPrint - prints the given counters
+INPUT:
+	@param stats - counters to print
+	@param output - open stream to print into
+*/
+void mtmStatsPrint(const MatamazomStats* stats, FILE* output);
+
+#endif //MATAMAZOM_STATS_H_
@@ -0,0 +1,51 @@
+#include "mtm_allocator.h"
+#include <stdlib.h>
+#include <assert.h>
+
+//malloc and free with the allocator signature
+static void* defaultAllocate(void* context, size_t size) {
+	(void)context;
+	return malloc(size);
+}
+
+static void defaultRelease(void* context, void* ptr) {
+	(void)context;
+	free(ptr);
+}
+
+static const MtmAllocator default_allocator = {
+	defaultAllocate,
+	defaultRelease,
+	NULL
+};
+
+const MtmAllocator* mtmDefaultAllocator() {
+	return &default_allocator;
+}
+
+void* mtmAllocate(const MtmAllocator* allocator, size_t size) {
+	assert(allocator != NULL && allocator->allocate != NULL);
+	return allocator->allocate(allocator->context, size);
+}
+
+void mtmRelease(const MtmAllocator* allocator, void* ptr) {
+	assert(allocator != NULL);
+	if (ptr != NULL && allocator->release != NULL) {
+		allocator->release(allocator->context, ptr);
+	}
+}
+
+void mtmMemoryAdd(MtmMemoryCounter* counter, size_t count, size_t bytes) {
+	if (counter != NULL) {
+		counter->count += count;
+		counter->bytes += bytes;
+	}
+}
+
+void mtmMemorySub(MtmMemoryCounter* counter, size_t count, size_t bytes) {
+	if (counter != NULL) {
+		assert(counter->count >= count && counter->bytes >= bytes);
+		counter->count -= count;
+		counter->bytes -= bytes;
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef MTM_ALLOCATOR_H_
+#define MTM_ALLOCATOR_H_
+#include <stddef.h>
+
+/** Type for defining an allocation function, context is the allocator's */
+typedef void* (*MtmAllocate)(void* context, size_t size);
+
+/** Type for defining a release function for memory given by MtmAllocate */
+typedef void (*MtmRelease)(void* context, void* ptr);
+
+/*
+allocator used by the amount set, orders and the warehouse.
+release may be NULL for allocators that reclaim their memory all at once
+(e.g. an arena that is reset after matamazomDestroy).
+*/
+typedef struct MtmAllocator_t {
+	MtmAllocate allocate;//allocation function, cant be NULL
+	MtmRelease release;//release function, NULL if releasing is a no-op
+	void* context;//passed as is to allocate and release
+} MtmAllocator;
+
+/*
+mtmDefaultAllocator - returns the malloc/free based allocator
+*/
+const MtmAllocator* mtmDefaultAllocator();
+
+/*
+mtmAllocate - allocates memory with the given allocator
+INPUT:
+	@param allocator - allocator to use
+	@param size - number of bytes
+OUTPUT:
+	the allocated memory, NULL if failed
+*/
+void* mtmAllocate(const MtmAllocator* allocator, size_t size);
+
+/*
+mtmRelease - releases memory that was allocated with the given allocator
+INPUT:
+	@param allocator - allocator that allocated ptr
+	@param ptr - memory to release, may be NULL
+*/
+void mtmRelease(const MtmAllocator* allocator, void* ptr);
+
+/*
+memory counters are kept by the allocation paths of the amount set, orders,
+name table and warehouse, so memory usage is known without walking the
+structures. a NULL counter counts nothing.
+*/
+typedef struct MtmMemoryCounter_t {
+	size_t count;//live elements
+	size_t bytes;//bytes allocated for them
+} MtmMemoryCounter;
+
+/*
+mtmMemoryAdd - counts an allocation
+INPUT:
+	@param counter - counter to increase, may be NULL
+	@param count - number of elements allocated
+	@param bytes - number of bytes allocated
+*/
+void mtmMemoryAdd(MtmMemoryCounter* counter, size_t count, size_t bytes);
+
+/*
+mtmMemorySub - counts a release of memory counted with mtmMemoryAdd
+INPUT:
+	@param counter - counter to decrease, may be NULL
+	@param count - number of elements released
+	@param bytes - number of bytes released
+*/
+void mtmMemorySub(MtmMemoryCounter* counter, size_t count, size_t bytes);
+
+#endif //MTM_ALLOCATOR_H_
@@ -0,0 +1,233 @@
+#include "name_index.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define INITIAL_CAPACITY 16
+
+//defining index entry
+typedef struct NameIndexEntry_t {
+	NameEntry name;//interned name
+	unsigned int id;
+} NameIndexEntry;
+
+//defining name index
+struct NameIndex_t {
+	NameIndexEntry* entries;//sorted by name and then id
+	int size;
+	int capacity;
+	NameTable names;//table the names are interned in
+	const MtmAllocator* allocator;
+	MtmMemoryCounter* memory;//counts pairs and the array, may be NULL
+};
+
+/*
+compareNameIndexEntry - compares an entry with a (name, id) pair
+INPUT:
+	@param entry - the entry
+	@param name - name of the pair
+	@param id - id of the pair
+OUTPUT:
+	< 0 if the entry is smaller, > 0 if bigger, 0 if equal
+*/
+static int compareNameIndexEntry(const NameIndexEntry* entry,
+                                 const char* name, unsigned int id) {
+
+	int name_result = strcmp(nameEntryGet(entry->name), name);
+	if (name_result != 0) {
+		return name_result;
+	}
+	return (entry->id > id) - (entry->id < id);
+}
+
+/*
+nameIndexLowerBound - returns the position of the first entry that isnt
+smaller than the (name, id) pair
+INPUT:
+	@param index - the index
+	@param name - name of the pair
+	@param id - id of the pair
+OUTPUT:
+	the position, size of the index if there is none
+*/
+static int nameIndexLowerBound(NameIndex index, const char* name,
+                               unsigned int id) {
+
+	int low = 0, high = index->size;
+	while (low < high) {
+		int middle = low + (high - low) / 2;
+		if (compareNameIndexEntry(&index->entries[middle], name, id) < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/*
+compareNameIndexEntries - compares two entries for qsort
+INPUT:
+	@param entry1 - first entry
+	@param entry2 - second entry
+OUTPUT:
+	< 0 if entry1 is smaller, > 0 if bigger, 0 if equal
+*/
+static int compareNameIndexEntries(const void* entry1, const void* entry2) {
+	const NameIndexEntry* other = entry2;
+	return compareNameIndexEntry(entry1, nameEntryGet(other->name),
+	                             other->id);
+}
+
+bool nameIndexReserve(NameIndex index, int count) {
+
+	if (index->size + count <= index->capacity) {
+		return true;
+	}
+	int capacity = (index->capacity == 0) ? INITIAL_CAPACITY :
+	               index->capacity * 2;
+	while (capacity < index->size + count) {
+		capacity *= 2;
+	}
+	NameIndexEntry* entries = mtmAllocate(index->allocator,
+	                                      sizeof(*entries) * capacity);
+	if (entries == NULL) {
+		return false;
+	}
+	if (index->size > 0) {
+		memcpy(entries, index->entries, sizeof(*entries) * index->size);
+	}
+	mtmRelease(index->allocator, index->entries);
+	mtmMemorySub(index->memory, 0, sizeof(*entries) * index->capacity);
+	mtmMemoryAdd(index->memory, 0, sizeof(*entries) * capacity);
+	index->entries = entries;
+	index->capacity = capacity;
+	return true;
+}
+
+NameIndex nameIndexCreate(NameTable names, const MtmAllocator* allocator) {
+
+	if (names == NULL || allocator == NULL) {
+		return NULL;
+	}
+	NameIndex index = mtmAllocate(allocator, sizeof(*index));
+	if (index == NULL) {
+		return NULL;
+	}
+	index->entries = NULL;
+	index->size = 0;
+	index->capacity = 0;
+	index->names = names;
+	index->allocator = allocator;
+	index->memory = NULL;
+	return index;
+}
+
+void nameIndexDestroy(NameIndex index) {
+
+	if (index == NULL) {
+		return;
+	}
+	for (int i = 0; i < index->size; i++) {
+		nameEntryRelease(index->entries[i].name);
+	}
+	mtmMemorySub(index->memory, index->size,
+	             sizeof(*index->entries) * index->capacity);
+	mtmRelease(index->allocator, index->entries);
+	mtmRelease(index->allocator, index);
+}
+
+void nameIndexSetMemoryCounter(NameIndex index, MtmMemoryCounter* counter) {
+
+	assert(index != NULL);
+	mtmMemorySub(index->memory, index->size,
+	             sizeof(*index->entries) * index->capacity);
+	index->memory = counter;
+	mtmMemoryAdd(index->memory, index->size,
+	             sizeof(*index->entries) * index->capacity);
+}
+
+bool nameIndexInsert(NameIndex index, const char* name, unsigned int id) {
+
+	assert(index != NULL && name != NULL);
+	if (!nameIndexReserve(index, 1)) {
+		return false;
+	}
+	NameEntry interned_name = nameTableIntern(index->names, name);
+	if (interned_name == NULL) {
+		return false;
+	}
+
+	//moves the bigger entries one place to make room
+	int position = nameIndexLowerBound(index, name, id);
+	memmove(&index->entries[position + 1], &index->entries[position],
+	        sizeof(*index->entries) * (index->size - position));
+	index->entries[position].name = interned_name;
+	index->entries[position].id = id;
+	index->size++;
+	mtmMemoryAdd(index->memory, 1, 0);
+	return true;
+}
+
+bool nameIndexInsertMany(NameIndex index, const NameIndexPair* pairs,
+                         int count) {
+
+	assert(index != NULL && (pairs != NULL || count == 0));
+	if (!nameIndexReserve(index, count)) {
+		return false;
+	}
+
+	//appends the pairs after the entries, then sorts them all
+	for (int i = 0; i < count; i++) {
+		NameIndexEntry* entry = &index->entries[index->size + i];
+		entry->name = nameTableIntern(index->names, pairs[i].name);
+		if (entry->name == NULL) {
+			while (--i >= 0) {//releases the names interned so far
+				nameEntryRelease(index->entries[index->size + i].name);
+			}
+			return false;
+		}
+		entry->id = pairs[i].id;
+	}
+	index->size += count;
+	mtmMemoryAdd(index->memory, count, 0);
+	qsort(index->entries, index->size, sizeof(*index->entries),
+	      compareNameIndexEntries);
+	return true;
+}
+
+void nameIndexRemove(NameIndex index, const char* name, unsigned int id) {
+
+	assert(index != NULL && name != NULL);
+	int position = nameIndexLowerBound(index, name, id);
+	if (position == index->size ||
+	    compareNameIndexEntry(&index->entries[position], name, id) != 0) {
+		return;//not in the index
+	}
+	nameEntryRelease(index->entries[position].name);
+	memmove(&index->entries[position], &index->entries[position + 1],
+	        sizeof(*index->entries) * (index->size - position - 1));
+	index->size--;
+	mtmMemorySub(index->memory, 1, 0);
+}
+
+void nameIndexFind(NameIndex index, const char* prefix, bool exact,
+                   NameIndexVisitor visitor, void* context) {
+
+	assert(index != NULL && prefix != NULL && visitor != NULL);
+	size_t length = strlen(prefix);
+
+	//(prefix, 0) is the smallest pair that can start with prefix
+	for (int i = nameIndexLowerBound(index, prefix, 0); i < index->size; i++) {
+		const char* name = nameEntryGet(index->entries[i].name);
+		if (strncmp(name, prefix, length) != 0) {
+			break;//sorted, so no later name starts with prefix
+		}
+		if (exact && name[length] != '\0') {
+			break;//longer names follow the exact ones
+		}
+		if (!visitor(index->entries[i].id, name, context)) {
+			break;
+		}
+	}
+}
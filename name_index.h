@@ -0,0 +1,109 @@
+#ifndef NAME_INDEX_H_
+#define NAME_INDEX_H_
+#include <stdbool.h>
+#include "mtm_allocator.h"
+#include "name_table.h"
+
+/*
+index of (name, id) pairs sorted by name and then by id, for lookups of
+products by name or name prefix. names are interned in a name table, so
+the index shares them with the products.
+*/
+
+/** Type for defining the name index */
+typedef struct NameIndex_t* NameIndex;
+
+/** Type for defining a visitor of index entries, returns false to stop */
+typedef bool (*NameIndexVisitor)(unsigned int id, const char* name,
+                                 void* context);
+
+/*
+nameIndexCreate - creates an empty index
+INPUT:
+	@param names - table the names are interned in, must outlive the index
+	@param allocator - allocator of the index, must outlive it
+OUTPUT:
+	the new index, NULL if one of the args is NULL or out of memory
+*/
+NameIndex nameIndexCreate(NameTable names, const MtmAllocator* allocator);
+
+/*
+nameIndexDestroy - destroys the index and releases its names
+INPUT:
+	@param index - index to destroy, may be NULL
+*/
+void nameIndexDestroy(NameIndex index);
+
+/*
+nameIndexSetMemoryCounter - sets the counter of the pairs of the index and
+the bytes of its array
+INPUT:
+	@param index - the index
+	@param counter - the counter, NULL to stop counting
+*/
+void nameIndexSetMemoryCounter(NameIndex index, MtmMemoryCounter* counter);
+
+/*
+nameIndexInsert - adds a pair to the index, O(log n + n) for the move
+INPUT:
+	@param index - the index
+	@param name - name of the pair
+	@param id - id of the pair, a pair is added at most once
+OUTPUT:
+	false if out of memory (the index isnt changed), else true
+*/
+bool nameIndexInsert(NameIndex index, const char* name, unsigned int id);
+
+/** Type for defining a (name, id) pair of nameIndexInsertMany */
+typedef struct NameIndexPair_t {
+	const char* name;
+	unsigned int id;
+} NameIndexPair;
+
+/*
+nameIndexInsertMany - adds many pairs to the index with one sort,
+O((n + count) log(n + count)) instead of count inserts
+INPUT:
+	@param index - the index
+	@param pairs - pairs to add, none of them in the index
+	@param count - number of pairs
+OUTPUT:
+	false if out of memory (the index isnt changed), else true
+*/
+bool nameIndexInsertMany(NameIndex index, const NameIndexPair* pairs,
+                         int count);
+
+/*
+nameIndexReserve - makes room for count more pairs, so that many inserts
+dont grow the index
+INPUT:
+	@param index - the index
+	@param count - number of pairs
+OUTPUT:
+	false if out of memory, else true
+*/
+bool nameIndexReserve(NameIndex index, int count);
+
+/*
+nameIndexRemove - removes a pair from the index, missing pairs are ignored
+INPUT:
+	@param index - the index
+	@param name - name of the pair
+	@param id - id of the pair
+*/
+void nameIndexRemove(NameIndex index, const char* name, unsigned int id);
+
+/*
+nameIndexFind - visits the pairs whose name starts with prefix (or equals
+it), in name order, O(log n + prefix + results)
+INPUT:
+	@param index - the index
+	@param prefix - prefix or whole name to look for
+	@param exact - true to visit only names equal to prefix
+	@param visitor - called for every pair found until it returns false
+	@param context - passed as is to visitor
+*/
+void nameIndexFind(NameIndex index, const char* prefix, bool exact,
+                   NameIndexVisitor visitor, void* context);
+
+#endif //NAME_INDEX_H_
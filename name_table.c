@@ -0,0 +1,204 @@
+#include "name_table.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define INITIAL_BUCKETS 16
+#define MAX_LOAD 2 //entries per bucket before the table grows
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+//defining interned name entry
+struct NameEntry_t {
+	NameTable table;//owning table, for removal on the last release
+	NameEntry next;//next entry of the bucket
+	unsigned int hash;//hash of name
+	int refcount;//number of handles
+	char name[];//the string itself
+};
+
+//defining intern table
+struct NameTable_t {
+	NameEntry* buckets;//chained hash buckets
+	int num_buckets;//always a power of 2
+	int size;//number of entries
+	const MtmAllocator* allocator;//allocator of the table and entries
+	MtmMemoryCounter* memory;//counts entries and buckets, may be NULL
+};
+
+/*
+hashName - FNV-1a hash of a string
+INPUT:
+	@param name - the string
+OUTPUT:
+	the hash
+*/
+static unsigned int hashName(const char* name) {
+
+	unsigned int hash = FNV_OFFSET;
+	for (; *name != '\0'; name++) {
+		hash = (hash ^ (unsigned char)*name) * FNV_PRIME;
+	}
+	return hash;
+}
+
+/*
+nameTableGrow - doubles the number of buckets and rehashes the entries,
+the table stays as is if out of memory
+INPUT:
+	@param table - the table
+*/
+static void nameTableGrow(NameTable table) {
+
+	int num_buckets = table->num_buckets * 2;
+	NameEntry* buckets = mtmAllocate(table->allocator,
+	                                 sizeof(*buckets) * num_buckets);
+	if (buckets == NULL) {
+		return;//longer chains, still correct
+	}
+	memset(buckets, 0, sizeof(*buckets) * num_buckets);
+
+	for (int i = 0; i < table->num_buckets; i++) {
+		NameEntry entry = table->buckets[i];
+		while (entry != NULL) {
+			NameEntry next = entry->next;
+			int bucket = entry->hash & (num_buckets - 1);
+			entry->next = buckets[bucket];
+			buckets[bucket] = entry;
+			entry = next;
+		}
+	}
+	mtmRelease(table->allocator, table->buckets);
+	mtmMemoryAdd(table->memory, 0,
+	             sizeof(*buckets) * (num_buckets - table->num_buckets));
+	table->buckets = buckets;
+	table->num_buckets = num_buckets;
+}
+
+NameTable nameTableCreate(const MtmAllocator* allocator) {
+
+	if (allocator == NULL) {
+		return NULL;
+	}
+	NameTable table = mtmAllocate(allocator, sizeof(*table));
+	if (table == NULL) {
+		return NULL;
+	}
+	table->buckets = mtmAllocate(allocator,
+	                             sizeof(*table->buckets) * INITIAL_BUCKETS);
+	if (table->buckets == NULL) {
+		mtmRelease(allocator, table);
+		return NULL;
+	}
+	memset(table->buckets, 0, sizeof(*table->buckets) * INITIAL_BUCKETS);
+	table->num_buckets = INITIAL_BUCKETS;
+	table->size = 0;
+	table->allocator = allocator;
+	table->memory = NULL;
+	return table;
+}
+
+void nameTableDestroy(NameTable table) {
+
+	if (table == NULL) {
+		return;
+	}
+	assert(table->size == 0);//every handle must be released first
+	mtmMemorySub(table->memory, 0,
+	             sizeof(*table->buckets) * table->num_buckets);
+	mtmRelease(table->allocator, table->buckets);
+	mtmRelease(table->allocator, table);
+}
+
+NameEntry nameTableIntern(NameTable table, const char* name) {
+
+	if (table == NULL || name == NULL) {
+		return NULL;
+	}
+
+	//returns the existing entry if the name is interned
+	unsigned int hash = hashName(name);
+	for (NameEntry entry = table->buckets[hash & (table->num_buckets - 1)];
+	     entry != NULL; entry = entry->next) {
+		if (entry->hash == hash && strcmp(entry->name, name) == 0) {
+			entry->refcount++;
+			return entry;
+		}
+	}
+
+	size_t length = strlen(name);
+	NameEntry entry = mtmAllocate(table->allocator,
+	                              sizeof(*entry) + length + 1);
+	if (entry == NULL) {
+		return NULL;
+	}
+	memcpy(entry->name, name, length + 1);
+	entry->table = table;
+	entry->hash = hash;
+	entry->refcount = 1;
+	mtmMemoryAdd(table->memory, 1, sizeof(*entry) + length + 1);
+
+	if (table->size >= table->num_buckets * MAX_LOAD) {
+		nameTableGrow(table);
+	}
+	int bucket = hash & (table->num_buckets - 1);
+	entry->next = table->buckets[bucket];
+	table->buckets[bucket] = entry;
+	table->size++;
+	return entry;
+}
+
+void nameTableSetMemoryCounter(NameTable table, MtmMemoryCounter* counter) {
+
+	if (table == NULL) {
+		return;
+	}
+	assert(table->size == 0);//entries arent counted yet
+	table->memory = counter;
+	mtmMemoryAdd(counter, 0, sizeof(*table->buckets) * table->num_buckets);
+}
+
+int nameTableSize(NameTable table) {
+	return (table == NULL) ? 0 : table->size;
+}
+
+bool nameTableReserve(NameTable table, int count) {
+
+	assert(table != NULL);
+	while (count > table->num_buckets * MAX_LOAD) {
+		int num_buckets = table->num_buckets;
+		nameTableGrow(table);
+		if (table->num_buckets == num_buckets) {
+			return false;
+		}
+	}
+	return true;
+}
+
+NameEntry nameEntryRetain(NameEntry entry) {
+	assert(entry != NULL);
+	entry->refcount++;
+	return entry;
+}
+
+void nameEntryRelease(NameEntry entry) {
+
+	if (entry == NULL || --entry->refcount > 0) {
+		return;
+	}
+
+	//last handle - unlinks the entry from its bucket and frees it
+	NameTable table = entry->table;
+	NameEntry* link = &table->buckets[entry->hash & (table->num_buckets - 1)];
+	while (*link != entry) {
+		link = &(*link)->next;
+	}
+	*link = entry->next;
+	table->size--;
+	mtmMemorySub(table->memory, 1, sizeof(*entry) + strlen(entry->name) + 1);
+	mtmRelease(table->allocator, entry);
+}
+
+const char* nameEntryGet(NameEntry entry) {
+	return (entry == NULL) ? NULL : entry->name;
+}
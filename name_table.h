@@ -0,0 +1,102 @@
+#ifndef NAME_TABLE_H_
+#define NAME_TABLE_H_
+#include <stdbool.h>
+#include "mtm_allocator.h"
+
+/*
+string intern table of the warehouse. interning a name returns a shared
+immutable handle, equal names get the same handle, so copies of a product
+share its name instead of copying it. handles are reference counted and
+an entry is freed when its last handle is released.
+*/
+
+/** Type for defining the intern table */
+typedef struct NameTable_t* NameTable;
+
+/** Type for defining a handle of an interned name */
+typedef struct NameEntry_t* NameEntry;
+
+/*
+nameTableCreate - creates an empty table
+INPUT:
+	@param allocator - allocator of the table and entries, must outlive it
+OUTPUT:
+	the new table, NULL if allocator is NULL or out of memory
+*/
+NameTable nameTableCreate(const MtmAllocator* allocator);
+
+/*
+nameTableDestroy - destroys the table, all its handles must be released
+INPUT:
+	@param table - table to destroy, may be NULL
+*/
+void nameTableDestroy(NameTable table);
+
+/*
+nameTableIntern - returns a handle of the given name, a new entry is
+created only if the name isnt interned yet
+INPUT:
+	@param table - the table
+	@param name - name to intern, copied into the entry
+OUTPUT:
+	the handle (released with nameEntryRelease), NULL if one of the args is
+	NULL or out of memory
+*/
+NameEntry nameTableIntern(NameTable table, const char* name);
+
+/*
+nameTableSetMemoryCounter - sets a counter of the entries of the table
+(count) and of the bytes of the entries and buckets
+INPUT:
+	@param table - an empty table
+	@param counter - counter to update
+*/
+void nameTableSetMemoryCounter(NameTable table, MtmMemoryCounter* counter);
+
+/*
+nameTableReserve - grows the buckets of the table for count entries up
+front, so interning that many names doesnt rehash it
+INPUT:
+	@param table - the table
+	@param count - number of entries
+OUTPUT:
+	false if out of memory, else true
+*/
+bool nameTableReserve(NameTable table, int count);
+
+/*
+nameTableSize - returns the number of distinct interned names
+INPUT:
+	@param table - the table
+OUTPUT:
+	number of entries, 0 if table is NULL
+*/
+int nameTableSize(NameTable table);
+
+/*
+nameEntryRetain - adds a reference to the handle, O(1)
+INPUT:
+	@param entry - the handle
+OUTPUT:
+	the same handle
+*/
+NameEntry nameEntryRetain(NameEntry entry);
+
+/*
+nameEntryRelease - drops a reference to the handle, the entry is freed
+when no references are left
+INPUT:
+	@param entry - the handle, may be NULL
+*/
+void nameEntryRelease(NameEntry entry);
+
+/*
+nameEntryGet - returns the interned string of the handle
+INPUT:
+	@param entry - the handle
+OUTPUT:
+	the string, NULL if entry is NULL
+*/
+const char* nameEntryGet(NameEntry entry);
+
+#endif //NAME_TABLE_H_
@@ -1,4 +1,5 @@
 #include "order.h"
+#include "amount_set_ext.h"
 #include <stdlib.h>
 #include <assert.h>
 
@@ -6,18 +7,21 @@
 
 ASElement copyOrder(ListElement source_element) {
 
+	//convert element to order
+	Order source_order = (Order)source_element;
+
 	//creates new order and checks if valid
-	Order dest_order = malloc(sizeof(*dest_order));
+	Order dest_order = mtmAllocate(source_order->allocator,
+	                               sizeof(*dest_order));
 	if (dest_order == NULL)
 	{
 		return NULL;
 	}
 
-	//convert element to order
-	Order source_order = (Order)source_element;
-
 	//regular copy
 	dest_order->order_id = source_order->order_id;
+	dest_order->allocator = source_order->allocator;
+	dest_order->headers = source_order->headers;
 
 	//deep copy
 	dest_order->order_products = asCopy(source_order->order_products);
@@ -26,10 +30,11 @@ ASElement copyOrder(ListElement source_element) {
 		source_order->order_products != NULL) {
 		//garunteed fail in asCopy, frees allocated memory
 		//if source_order->order_products==NULL asCopy returns NULL
-		free(dest_order);
+		mtmRelease(dest_order->allocator, dest_order);
 
 		return NULL;
 	}
+	mtmMemoryAdd(dest_order->headers, 1, sizeof(*dest_order));
 
 	//passed all copies, returns dest product
 	return dest_order;
@@ -48,33 +53,45 @@ void freeOrder(ListElement element_to_free) {
 		asDestroy(order_to_free->order_products);
 
 		//frees the allocated order
-		free(order_to_free);
+		mtmMemorySub(order_to_free->headers, 1, sizeof(*order_to_free));
+		mtmRelease(order_to_free->allocator, order_to_free);
 	}
 }
 
 
 Order orderCreate(unsigned int id,CopyASElement copyElement,
                   FreeASElement freeElement,
-                  CompareASElements compareElements ){
-    
+                  CompareASElements compareElements,
+                  GetASElementKey getKey,
+                  const MtmAllocator* allocator){
+
+	if (allocator == NULL) {
+		return NULL;
+	}
+
 	//allocates new order and checks if valid
-	Order new_order = malloc(sizeof(*new_order));
+	Order new_order = mtmAllocate(allocator, sizeof(*new_order));
     if(new_order == NULL){
         return NULL;
     }
 
     new_order->order_id=id;
+	new_order->allocator = allocator;
+	new_order->headers = NULL;
 	
 	//creates amount set of products and checks if valid
-	new_order->order_products = asCreate(copyElement,
+	new_order->order_products = asCreateKeyed(copyElement,
             freeElement,
-            compareElements);
+            compareElements, getKey, allocator);
     if (new_order->order_products == NULL)
     {
         //if fail - frees memory
-		free(new_order);
+		mtmRelease(allocator, new_order);
         return NULL;
     }
+	//order products are never changed in place, so copies of the order
+	//(the list keeps one) share them until one of the orders changes
+	asSetCopyOnWrite(new_order->order_products, true);
 
     return new_order;
 }
@@ -83,4 +100,12 @@ void orderDestroy(Order order){
 	freeOrder(order);
 }
 
+void orderSetMemoryCounters(Order order, MtmMemoryCounter* headers,
+                            MtmMemoryCounter* lines) {
+	assert(order != NULL && order->headers == NULL);
+	order->headers = headers;
+	mtmMemoryAdd(headers, 1, sizeof(*order));
+	asSetMemoryCounter(order->order_products, lines);
+}
+
 
@@ -3,13 +3,17 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "amount_set.h"
+#include "amount_set_ext.h"
 #include "list.h"
+#include "mtm_allocator.h"
 
 /** Type for defining the order struct */
 //define Order_t struct
 typedef struct Order_t {
 	unsigned int order_id;
 	AmountSet order_products;
+	const MtmAllocator* allocator;//allocator of the order and its products
+	MtmMemoryCounter* headers;//counts the order structs, may be NULL
 }*Order;
 
 /*
@@ -35,12 +39,16 @@ INPUT:
 	@param copyElement - copy product func 
     @param freeElement - free product func
     @param compareElements -compare products func
+    @param getKey - product key func, the products set is keyed by it
+    @param allocator - allocator for the order and its amount set
 OUTPUT:
 	the created order. if error returns NULL
 */
 Order orderCreate(unsigned int id,CopyASElement copyElement,
                   FreeASElement freeElement,
-                  CompareASElements compareElements);
+                  CompareASElements compareElements,
+                  GetASElementKey getKey,
+                  const MtmAllocator* allocator);
 
 /*
 orderDestroy - destroys given order
@@ -50,5 +58,16 @@ INPUT:
 */
 void orderDestroy(Order order);
 
+/*
+orderSetMemoryCounters - sets the memory counters of a new order, its
+copies share them
+INPUT:
+	@param order - order with no products yet
+	@param headers - counter of the order structs, counts this order too
+	@param lines - counter of the nodes of the products set
+*/
+void orderSetMemoryCounters(Order order, MtmMemoryCounter* headers,
+                            MtmMemoryCounter* lines);
+
 
 #endif //ORDER_H_
\ No newline at end of file
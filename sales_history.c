@@ -0,0 +1,163 @@
+#include "sales_history.h"
+#include <stdlib.h>
+#include <assert.h>
+
+#define CHUNK_RECORDS 128
+
+//defining chunk of records
+typedef struct SalesChunk_t* SalesChunk;
+struct SalesChunk_t {
+	SalesChunk prev;//older chunk (or next spare chunk)
+	int size;//used records
+	SalesRecord records[CHUNK_RECORDS];
+};
+
+//defining sales history
+struct SalesHistory_t {
+	SalesChunk newest;//chunk appended to, NULL while empty
+	SalesChunk spares;//reserved empty chunks
+	int spare_records;//free records in newest and spares
+	int chunks;//allocated chunks
+	unsigned int shipments;//ended shipments
+	size_t records;//appended records
+	const MtmAllocator* allocator;
+	MtmMemoryCounter* memory;//counts records and chunks, may be NULL
+};
+
+/*
+salesChunkChainDestroy - frees a chain of chunks linked by prev
+INPUT:
+	@param allocator - allocator of the chunks
+	@param chunk - first chunk of the chain
+*/
+static void salesChunkChainDestroy(const MtmAllocator* allocator,
+                                   SalesChunk chunk) {
+	while (chunk != NULL) {
+		SalesChunk prev = chunk->prev;
+		mtmRelease(allocator, chunk);
+		chunk = prev;
+	}
+}
+
+SalesHistory salesHistoryCreate(const MtmAllocator* allocator) {
+
+	if (allocator == NULL) {
+		return NULL;
+	}
+	SalesHistory history = mtmAllocate(allocator, sizeof(*history));
+	if (history == NULL) {
+		return NULL;
+	}
+	history->newest = NULL;
+	history->spares = NULL;
+	history->spare_records = 0;
+	history->chunks = 0;
+	history->shipments = 0;
+	history->records = 0;
+	history->allocator = allocator;
+	history->memory = NULL;
+	return history;
+}
+
+void salesHistoryDestroy(SalesHistory history) {
+
+	if (history == NULL) {
+		return;
+	}
+	salesChunkChainDestroy(history->allocator, history->newest);
+	salesChunkChainDestroy(history->allocator, history->spares);
+	mtmMemorySub(history->memory, history->records,
+	             history->chunks * sizeof(struct SalesChunk_t));
+	mtmRelease(history->allocator, history);
+}
+
+void salesHistorySetMemoryCounter(SalesHistory history,
+                                  MtmMemoryCounter* counter) {
+
+	assert(history != NULL);
+	mtmMemorySub(history->memory, history->records,
+	             history->chunks * sizeof(struct SalesChunk_t));
+	history->memory = counter;
+	mtmMemoryAdd(history->memory, history->records,
+	             history->chunks * sizeof(struct SalesChunk_t));
+}
+
+bool salesHistoryReserve(SalesHistory history, int count) {
+
+	assert(history != NULL);
+	while (history->spare_records < count) {
+		SalesChunk chunk = mtmAllocate(history->allocator, sizeof(*chunk));
+		if (chunk == NULL) {
+			return false;//already reserved chunks are kept for later
+		}
+		chunk->size = 0;
+		chunk->prev = history->spares;
+		history->spares = chunk;
+		history->spare_records += CHUNK_RECORDS;
+		history->chunks++;
+		mtmMemoryAdd(history->memory, 0, sizeof(*chunk));
+	}
+	return true;
+}
+
+void salesHistoryAppend(SalesHistory history, unsigned int order_id,
+                        unsigned int product_id, double amount, double price) {
+
+	assert(history != NULL && history->spare_records > 0);
+
+	//moves to a spare chunk when the newest is full
+	if (history->newest == NULL || history->newest->size == CHUNK_RECORDS) {
+		SalesChunk chunk = history->spares;
+		history->spares = chunk->prev;
+		chunk->prev = history->newest;
+		history->newest = chunk;
+	}
+
+	SalesRecord* record = &history->newest->records[history->newest->size++];
+	record->amount = amount;
+	record->price = price;
+	record->order_id = order_id;
+	record->seq = history->shipments + 1;
+	record->product_id = product_id;
+	history->spare_records--;
+	history->records++;
+	mtmMemoryAdd(history->memory, 1, 0);
+}
+
+void salesHistoryEndShipment(SalesHistory history) {
+	assert(history != NULL);
+	history->shipments++;
+}
+
+unsigned int salesHistoryShipments(SalesHistory history) {
+	assert(history != NULL);
+	return history->shipments;
+}
+
+double salesHistoryRevenue(SalesHistory history, unsigned int last_shipments,
+                           unsigned int low_id, unsigned int high_id) {
+
+	assert(history != NULL);
+	//records of shipments up to first_excluded are out of the window
+	unsigned int first_excluded = 0;
+	if (last_shipments != 0 && last_shipments < history->shipments) {
+		first_excluded = history->shipments - last_shipments;
+	}
+
+	//walks back from the newest record until the window ends
+	double revenue = 0;
+	for (SalesChunk chunk = history->newest; chunk != NULL;
+	     chunk = chunk->prev) {
+		for (int i = chunk->size - 1; i >= 0; i--) {
+			const SalesRecord* record = &chunk->records[i];
+			if (record->seq <= first_excluded) {
+				return revenue;
+			}
+			if (record->product_id >= low_id &&
+			    record->product_id <= high_id) {
+				revenue += record->price;
+			}
+		}
+	}
+	return revenue;
+}
@@ -0,0 +1,103 @@
+#ifndef SALES_HISTORY_H_
+#define SALES_HISTORY_H_
+#include <stdbool.h>
+#include "mtm_allocator.h"
+
+/*
+append-only log of shipped order lines. records are kept in fixed size
+chunks that are never moved, newest chunk first, so queries over the last
+shipments only walk the end of the log.
+*/
+
+/** Type for defining a record of a shipped order line */
+typedef struct SalesRecord_t {
+	double amount;//shipped amount
+	double price;//price paid for amount
+	unsigned int order_id;//shipped order
+	unsigned int seq;//shipment number, the first shipment is 1
+	unsigned int product_id;
+} SalesRecord;
+
+/** Type for defining the sales history */
+typedef struct SalesHistory_t* SalesHistory;
+
+/*
+salesHistoryCreate - creates an empty history
+INPUT:
+	@param allocator - allocator of the history, must outlive it
+OUTPUT:
+	the new history, NULL if allocator is NULL or out of memory
+*/
+SalesHistory salesHistoryCreate(const MtmAllocator* allocator);
+
+/*
+salesHistoryDestroy - destroys the history
+INPUT:
+	@param history - history to destroy, may be NULL
+*/
+void salesHistoryDestroy(SalesHistory history);
+
+/*
+salesHistorySetMemoryCounter - sets the counter of the records of the
+history and the bytes of its chunks
+INPUT:
+	@param history - the history
+	@param counter - the counter, NULL to stop counting
+*/
+void salesHistorySetMemoryCounter(SalesHistory history,
+                                  MtmMemoryCounter* counter);
+
+/*
+salesHistoryReserve - makes room for count more records, so the next
+count appends cant fail
+INPUT:
+	@param history - the history
+	@param count - number of records
+OUTPUT:
+	false if out of memory, else true
+*/
+bool salesHistoryReserve(SalesHistory history, int count);
+
+/*
+salesHistoryAppend - appends a record to the current shipment, room must
+be reserved with salesHistoryReserve first
+INPUT:
+	@param history - the history
+	@param order_id - shipped order
+	@param product_id - shipped product
+	@param amount - shipped amount
+	@param price - price paid for amount
+*/
+void salesHistoryAppend(SalesHistory history, unsigned int order_id,
+                        unsigned int product_id, double amount, double price);
+
+/*
+salesHistoryEndShipment - ends the current shipment, later records belong
+to the next one
+INPUT:
+	@param history - the history
+*/
+void salesHistoryEndShipment(SalesHistory history);
+
+/*
+salesHistoryShipments - returns the number of ended shipments
+INPUT:
+	@param history - the history
+*/
+unsigned int salesHistoryShipments(SalesHistory history);
+
+/*
+salesHistoryRevenue - sums the price of the records of the last shipments
+whose product id is in [low_id, high_id], walking back only over them
+INPUT:
+	@param history - the history
+	@param last_shipments - number of last shipments, 0 for all of them
+	@param low_id - lowest product id in range
+	@param high_id - highest product id in range
+OUTPUT:
+	the revenue
+*/
+double salesHistoryRevenue(SalesHistory history, unsigned int last_shipments,
+                           unsigned int low_id, unsigned int high_id);
+
+#endif //SALES_HISTORY_H_
@@ -0,0 +1,103 @@
+#include "sales_velocity.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+//defining sales velocity ring
+struct SalesVelocity_t {
+	int refcount;//copies of the product sharing the ring
+	int intervals;//number of slots
+	unsigned long tick;//interval of the last sale
+	double sum;//sum of the slots
+	const MtmAllocator* allocator;
+	MtmMemoryCounter* memory;//counter of the rings, may be NULL
+	double sold[];//amount sold in interval t is at slot t % intervals
+};
+
+/*
+getVelocitySize - returns the bytes of a ring
+INPUT:
+	@param intervals - number of slots of the ring
+*/
+static size_t getVelocitySize(int intervals) {
+	return sizeof(struct SalesVelocity_t) + intervals * sizeof(double);
+}
+
+SalesVelocity salesVelocityCreate(int intervals, unsigned long tick,
+                                  const MtmAllocator* allocator,
+                                  MtmMemoryCounter* counter) {
+
+	if (intervals <= 0 || allocator == NULL) {
+		return NULL;
+	}
+	SalesVelocity velocity = mtmAllocate(allocator,
+	                                     getVelocitySize(intervals));
+	if (velocity == NULL) {
+		return NULL;
+	}
+	velocity->refcount = 1;
+	velocity->intervals = intervals;
+	velocity->tick = tick;
+	velocity->sum = 0;
+	velocity->allocator = allocator;
+	velocity->memory = counter;
+	memset(velocity->sold, 0, intervals * sizeof(*velocity->sold));
+	mtmMemoryAdd(counter, 1, getVelocitySize(intervals));
+	return velocity;
+}
+
+SalesVelocity salesVelocityRetain(SalesVelocity velocity) {
+	if (velocity != NULL) {
+		velocity->refcount++;
+	}
+	return velocity;
+}
+
+void salesVelocityRelease(SalesVelocity velocity) {
+
+	if (velocity == NULL || --velocity->refcount > 0) {
+		return;
+	}
+	mtmMemorySub(velocity->memory, 1, getVelocitySize(velocity->intervals));
+	mtmRelease(velocity->allocator, velocity);
+}
+
+void salesVelocityAdd(SalesVelocity velocity, unsigned long tick,
+                      double amount) {
+
+	assert(velocity != NULL && tick >= velocity->tick);
+
+	//clears the slots of the intervals that passed, they are reused
+	unsigned long elapsed = tick - velocity->tick;
+	if (elapsed >= (unsigned long)velocity->intervals) {
+		memset(velocity->sold, 0,
+		       velocity->intervals * sizeof(*velocity->sold));
+		velocity->sum = 0;
+	}
+	else {
+		for (unsigned long i = 1; i <= elapsed; i++) {
+			double* slot = &velocity->sold[(velocity->tick + i) %
+			                               velocity->intervals];
+			velocity->sum -= *slot;
+			*slot = 0;
+		}
+	}
+	velocity->tick = tick;
+	velocity->sold[tick % velocity->intervals] += amount;
+	velocity->sum += amount;
+}
+
+double salesVelocityAverage(SalesVelocity velocity, unsigned long tick) {
+
+	assert(velocity != NULL && tick >= velocity->tick);
+	unsigned long elapsed = tick - velocity->tick;
+	if (elapsed >= (unsigned long)velocity->intervals) {
+		return 0;
+	}
+	double sum = velocity->sum;
+	for (unsigned long i = 1; i <= elapsed; i++) {
+		sum -= velocity->sold[(velocity->tick + i) % velocity->intervals];
+	}
+	//rounding of the running sum cant make it negative
+	return (sum > 0) ? sum / velocity->intervals : 0;
+}
@@ -0,0 +1,74 @@
+#ifndef SALES_VELOCITY_H_
+#define SALES_VELOCITY_H_
+#include "mtm_allocator.h"
+
+/*
+ring of the amounts of a product sold in the last intervals, with their
+running sum, so moving averages are read without summing the ring.
+intervals are numbered by the warehouse, which advances them with a tick.
+the ring is brought up to the current interval only when it is sold into,
+so a tick doesnt touch the products. rings are reference counted and
+shared by the copies of a product.
+*/
+
+/** Type for defining a sales velocity ring */
+typedef struct SalesVelocity_t* SalesVelocity;
+
+/*
+salesVelocityCreate - creates an empty ring
+INPUT:
+	@param intervals - number of intervals kept
+	@param tick - current interval
+	@param allocator - allocator of the ring, must outlive it
+	@param counter - counter of the rings and their bytes, may be NULL
+OUTPUT:
+	the new ring (released with salesVelocityRelease), NULL if intervals
+	isnt positive, allocator is NULL or out of memory
+*/
+SalesVelocity salesVelocityCreate(int intervals, unsigned long tick,
+                                  const MtmAllocator* allocator,
+                                  MtmMemoryCounter* counter);
+
+/*
+salesVelocityRetain - adds a reference to the ring, O(1)
+INPUT:
+	@param velocity - the ring, may be NULL
+OUTPUT:
+	the same ring
+*/
+SalesVelocity salesVelocityRetain(SalesVelocity velocity);
+
+/*
+salesVelocityRelease - drops a reference to the ring, it is freed when no
+references are left
+INPUT:
+	@param velocity - the ring, may be NULL
+*/
+void salesVelocityRelease(SalesVelocity velocity);
+
+/*
+salesVelocityAdd - adds a sold amount to the current interval. O(1), plus
+clearing the intervals that passed since the last sale (at most the
+number of intervals kept)
+INPUT:
+	@param velocity - the ring
+	@param tick - current interval, not before the last sale
+	@param amount - sold amount
+*/
+void salesVelocityAdd(SalesVelocity velocity, unsigned long tick,
+                      double amount);
+
+/*
+salesVelocityAverage - returns the average amount sold per interval over
+the intervals kept, the current one included. O(1) if the product was
+sold in the current interval, else the intervals that passed since the
+last sale are taken out of the running sum (the ring isnt changed)
+INPUT:
+	@param velocity - the ring
+	@param tick - current interval, not before the last sale
+OUTPUT:
+	the average
+*/
+double salesVelocityAverage(SalesVelocity velocity, unsigned long tick);
+
+#endif //SALES_VELOCITY_H_
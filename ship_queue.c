@@ -0,0 +1,361 @@
+#define _POSIX_C_SOURCE 200809L
+#include "ship_queue.h"
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+#include <assert.h>
+#include "matamazom_ext.h"
+#include "matamazom_stats.h"
+
+#define SHIP_BATCH 64 //requests shipped under one lock of the warehouse
+
+//instrumentation, expands to nothing when compiled without MATAMAZOM_STATS
+#ifdef MATAMAZOM_STATS
+#define STATS_START(start) double start = mtmStatsNow()
+#define STATS_RECORD(matamazom, api, result, start) \
+	mtmStatsRecordCall(matamazom, api, result, start)
+//the warehouse is read before a call that frees the queue
+#define STATS_SOURCE(matamazom, source) Matamazom matamazom = (source)
+#else
+#define STATS_START(start)
+#define STATS_RECORD(matamazom, api, result, start)
+#define STATS_SOURCE(matamazom, source)
+#endif
+
+//atomics with the gcc builtins, the tree is built as c99
+#define ATOMIC_LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST)
+#define ATOMIC_EXCHANGE(ptr, value) \
+	__atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST)
+
+//defining ship request, also the ticket of the request
+struct MtmShipRequest_t {
+	struct MtmShipRequest_t* next;//next request of the queue
+	unsigned int order_id;
+	MtmShipCallback callback;
+	void* context;
+	bool has_ticket;//the caller frees the request with mtmShipTicketWait
+	bool done;//set atomically by the worker, under done_lock
+	MatamazomResult result;
+	MtmAllocator allocator;//copy, the ticket may outlive the queue
+	//own wait of a ticket, the queue may be destroyed while it waits
+	pthread_mutex_t done_lock;//initialized only if has_ticket
+	pthread_cond_t done_cond;//signaled once done is set
+};
+
+typedef struct MtmShipRequest_t* ShipRequest;
+
+//defining ship queue, an intrusive mpsc queue with a stub node
+struct MtmShipQueue_t {
+	ShipRequest head;//consumer end, used by the worker only
+	ShipRequest tail;//producer end, exchanged atomically
+	struct MtmShipRequest_t stub;//keeps the queue non empty
+	Matamazom matamazom;
+	const MtmAllocator* allocator;//allocator of the warehouse
+	pthread_t worker;
+	pthread_mutex_t warehouse_lock;//held while using the warehouse
+	pthread_mutex_t state_lock;//guards sleeping and stopping
+	pthread_cond_t work_ready;//signaled when the sleeping worker has work
+	int sleeping;//1 while the worker waits for work
+	int stopping;//1 once the queue is being destroyed
+};
+
+/*
+shipQueuePush - pushes a request, lock free and safe for many producers
+INPUT:
+	@param queue - the queue
+	@param request - request to push
+*/
+static void shipQueuePush(MtmShipQueue queue, ShipRequest request) {
+	request->next = NULL;
+	ShipRequest prev = ATOMIC_EXCHANGE(&queue->tail, request);
+	ATOMIC_STORE(&prev->next, request);
+}
+
+/*
+shipQueuePop - pops the oldest request, called by the worker only
+INPUT:
+	@param queue - the queue
+OUTPUT:
+	the request, NULL if the queue is empty or a push is still linking
+*/
+static ShipRequest shipQueuePop(MtmShipQueue queue) {
+
+	ShipRequest head = queue->head;
+	ShipRequest next = ATOMIC_LOAD(&head->next);
+	if (head == &queue->stub) {//skips the stub
+		if (next == NULL) {
+			return NULL;
+		}
+		queue->head = next;
+		head = next;
+		next = ATOMIC_LOAD(&head->next);
+	}
+	if (next != NULL) {
+		queue->head = next;
+		return head;
+	}
+	if (ATOMIC_LOAD(&queue->tail) != head) {
+		return NULL;//a producer is between its two steps
+	}
+	//head is the last request, the stub is pushed so head can be taken
+	shipQueuePush(queue, &queue->stub);
+	next = ATOMIC_LOAD(&head->next);
+	if (next != NULL) {
+		queue->head = next;
+		return head;
+	}
+	return NULL;
+}
+
+/*
+shipQueueIsEmpty - checks whether no request is queued or being pushed
+INPUT:
+	@param queue - the queue
+*/
+static bool shipQueueIsEmpty(MtmShipQueue queue) {
+	return queue->head == &queue->stub &&
+	       ATOMIC_LOAD(&queue->tail) == &queue->stub;
+}
+
+/*
+shipQueueComplete - reports the results of a shipped batch
+INPUT:
+	@param batch - the shipped requests
+	@param count - number of requests
+*/
+static void shipQueueComplete(ShipRequest* batch, int count) {
+
+	for (int i = 0; i < count; i++) {
+		ShipRequest request = batch[i];
+		if (request->callback != NULL) {
+			request->callback(request->order_id, request->result,
+			                  request->context);
+		}
+		if (!request->has_ticket) {
+			mtmRelease(&request->allocator, request);
+			continue;
+		}
+		//the request belongs to its caller once done, so it isnt used
+		//after the unlock
+		pthread_mutex_lock(&request->done_lock);
+		ATOMIC_STORE(&request->done, true);
+		pthread_cond_signal(&request->done_cond);
+		pthread_mutex_unlock(&request->done_lock);
+	}
+}
+
+/*
+shipQueueWorker - main of the worker thread, ships batches until the
+queue is destroyed and empty
+INPUT:
+	@param argument - the queue
+*/
+static void* shipQueueWorker(void* argument) {
+
+	MtmShipQueue queue = argument;
+	ShipRequest batch[SHIP_BATCH];
+	while (true) {
+		int count = 0;
+		while (count < SHIP_BATCH &&
+		       (batch[count] = shipQueuePop(queue)) != NULL) {
+			count++;
+		}
+		if (count > 0) {
+			pthread_mutex_lock(&queue->warehouse_lock);
+			for (int i = 0; i < count; i++) {
+				batch[i]->result = mtmShipOrder(queue->matamazom,
+				                                batch[i]->order_id);
+			}
+			pthread_mutex_unlock(&queue->warehouse_lock);
+			shipQueueComplete(batch, count);
+			continue;
+		}
+
+		//sleeps until a producer signals, unless work arrived meanwhile
+		pthread_mutex_lock(&queue->state_lock);
+		ATOMIC_STORE(&queue->sleeping, 1);
+		if (!shipQueueIsEmpty(queue)) {
+			ATOMIC_STORE(&queue->sleeping, 0);
+			pthread_mutex_unlock(&queue->state_lock);
+			sched_yield();//lets a linking producer finish
+			continue;
+		}
+		if (queue->stopping) {
+			pthread_mutex_unlock(&queue->state_lock);
+			break;
+		}
+		pthread_cond_wait(&queue->work_ready, &queue->state_lock);
+		ATOMIC_STORE(&queue->sleeping, 0);
+		pthread_mutex_unlock(&queue->state_lock);
+	}
+	return NULL;
+}
+
+/*
+shipQueueCreate - implementation of mtmShipQueueCreate, wrapped by the
+instrumentation
+*/
+static MtmShipQueue shipQueueCreate(Matamazom matamazom) {
+
+	if (matamazom == NULL) {
+		return NULL;
+	}
+	const MtmAllocator* allocator = mtmGetAllocator(matamazom);
+	MtmShipQueue queue = mtmAllocate(allocator, sizeof(*queue));
+	if (queue == NULL) {
+		return NULL;
+	}
+	queue->allocator = allocator;
+	queue->stub.next = NULL;
+	queue->head = &queue->stub;
+	queue->tail = &queue->stub;
+	queue->matamazom = matamazom;
+	queue->sleeping = 0;
+	queue->stopping = 0;
+	pthread_mutex_init(&queue->warehouse_lock, NULL);
+	pthread_mutex_init(&queue->state_lock, NULL);
+	pthread_cond_init(&queue->work_ready, NULL);
+
+	if (pthread_create(&queue->worker, NULL, shipQueueWorker, queue) != 0) {
+		pthread_cond_destroy(&queue->work_ready);
+		pthread_mutex_destroy(&queue->state_lock);
+		pthread_mutex_destroy(&queue->warehouse_lock);
+		mtmRelease(allocator, queue);
+		return NULL;
+	}
+	return queue;
+}
+
+MtmShipQueue mtmShipQueueCreate(Matamazom matamazom) {
+	STATS_START(start);
+	MtmShipQueue queue = shipQueueCreate(matamazom);
+	STATS_RECORD(matamazom, MTM_STATS_SHIP_QUEUE_CREATE,
+	             (matamazom == NULL) ? MATAMAZOM_NULL_ARGUMENT :
+	             (queue == NULL) ? MATAMAZOM_OUT_OF_MEMORY :
+	                               MATAMAZOM_SUCCESS, start);
+	return queue;
+}
+
+/*
+shipQueueDestroy - implementation of mtmShipQueueDestroy, wrapped by the
+instrumentation
+*/
+static void shipQueueDestroy(MtmShipQueue queue) {
+
+	if (queue == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&queue->state_lock);
+	queue->stopping = 1;
+	pthread_cond_signal(&queue->work_ready);
+	pthread_mutex_unlock(&queue->state_lock);
+	pthread_join(queue->worker, NULL);
+
+	pthread_cond_destroy(&queue->work_ready);
+	pthread_mutex_destroy(&queue->state_lock);
+	pthread_mutex_destroy(&queue->warehouse_lock);
+	mtmRelease(queue->allocator, queue);
+}
+
+void mtmShipQueueDestroy(MtmShipQueue queue) {
+	STATS_START(start);
+	STATS_SOURCE(matamazom, (queue == NULL) ? NULL : queue->matamazom);
+	shipQueueDestroy(queue);
+	STATS_RECORD(matamazom, MTM_STATS_SHIP_QUEUE_DESTROY, MATAMAZOM_SUCCESS,
+	             start);
+}
+
+/*
+shipOrderAsync - implementation of mtmShipOrderAsync, wrapped by the
+instrumentation
+*/
+static MatamazomResult shipOrderAsync(MtmShipQueue queue,
+                                      const unsigned int orderId,
+                                      MtmShipCallback callback,
+                                      void* context, MtmShipTicket* ticket) {
+
+	if (queue == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	ShipRequest request = mtmAllocate(queue->allocator, sizeof(*request));
+	if (request == NULL) {
+		return MATAMAZOM_OUT_OF_MEMORY;
+	}
+	request->allocator = *queue->allocator;
+	request->order_id = orderId;
+	request->callback = callback;
+	request->context = context;
+	request->has_ticket = (ticket != NULL);
+	request->done = false;
+	request->result = MATAMAZOM_SUCCESS;
+	if (ticket != NULL) {
+		pthread_mutex_init(&request->done_lock, NULL);
+		pthread_cond_init(&request->done_cond, NULL);
+		*ticket = request;
+	}
+
+	shipQueuePush(queue, request);
+	//the mutex is taken only to wake a sleeping worker
+	if (ATOMIC_LOAD(&queue->sleeping)) {
+		pthread_mutex_lock(&queue->state_lock);
+		pthread_cond_signal(&queue->work_ready);
+		pthread_mutex_unlock(&queue->state_lock);
+	}
+	return MATAMAZOM_SUCCESS;
+}
+
+MatamazomResult mtmShipOrderAsync(MtmShipQueue queue,
+                                  const unsigned int orderId,
+                                  MtmShipCallback callback, void* context,
+                                  MtmShipTicket* ticket) {
+	STATS_START(start);
+	MatamazomResult result = shipOrderAsync(queue, orderId, callback,
+	                                        context, ticket);
+	STATS_RECORD((queue == NULL) ? NULL : queue->matamazom,
+	             MTM_STATS_SHIP_ORDER_ASYNC, result, start);
+	return result;
+}
+
+bool mtmShipTicketPoll(MtmShipTicket ticket) {
+
+	if (ticket == NULL) {
+		return false;
+	}
+	return ATOMIC_LOAD(&ticket->done);
+}
+
+MatamazomResult mtmShipTicketWait(MtmShipTicket ticket) {
+
+	if (ticket == NULL) {
+		return MATAMAZOM_NULL_ARGUMENT;
+	}
+	//waits on the ticket only, the queue may be destroyed meanwhile
+	pthread_mutex_lock(&ticket->done_lock);
+	while (!ticket->done) {
+		pthread_cond_wait(&ticket->done_cond, &ticket->done_lock);
+	}
+	pthread_mutex_unlock(&ticket->done_lock);
+
+	MatamazomResult result = ticket->result;
+	pthread_cond_destroy(&ticket->done_cond);
+	pthread_mutex_destroy(&ticket->done_lock);
+	mtmRelease(&ticket->allocator, ticket);
+	return result;
+}
+
+void mtmShipQueueLock(MtmShipQueue queue) {
+	assert(queue != NULL);
+	STATS_START(start);
+	pthread_mutex_lock(&queue->warehouse_lock);
+	STATS_RECORD(queue->matamazom, MTM_STATS_SHIP_QUEUE_LOCK,
+	             MATAMAZOM_SUCCESS, start);
+}
+
+void mtmShipQueueUnlock(MtmShipQueue queue) {
+	assert(queue != NULL);
+	STATS_START(start);
+	pthread_mutex_unlock(&queue->warehouse_lock);
+	STATS_RECORD(queue->matamazom, MTM_STATS_SHIP_QUEUE_UNLOCK,
+	             MATAMAZOM_SUCCESS, start);
+}
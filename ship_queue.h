@@ -0,0 +1,105 @@
+#ifndef SHIP_QUEUE_H_
+#define SHIP_QUEUE_H_
+#include <stdbool.h>
+#include "matamazom.h"
+
+/*
+asynchronous shipping of orders. mtmShipOrderAsync pushes a request on a
+lock free multi producer queue and returns at once, a worker thread of the
+queue drains the requests in batches and ships them with mtmShipOrder.
+
+the warehouse isnt thread safe, so while a queue exists every other use
+of the warehouse must be done between mtmShipQueueLock and
+mtmShipQueueUnlock. the worker holds that lock while shipping a batch.
+completion callbacks are called without the lock.
+the queue and its requests are allocated with the allocator of the
+warehouse, from the threads that call mtmShipOrderAsync and
+mtmShipTicketWait and from the worker. so with a ship queue that allocator
+must be thread safe (the default one is).
+the calls of the queue are counted in the stats of its warehouse, except
+mtmShipTicketPoll and mtmShipTicketWait: a ticket may outlive its queue
+and warehouse.
+*/
+
+/** Type for defining a ship queue of a warehouse */
+typedef struct MtmShipQueue_t* MtmShipQueue;
+
+/** Type for defining a handle of a pending ship request */
+typedef struct MtmShipRequest_t* MtmShipTicket;
+
+/** Type for defining a completion callback of a ship request */
+typedef void (*MtmShipCallback)(unsigned int orderId, MatamazomResult result,
+                                void* context);
+
+/*
+mtmShipQueueCreate - creates a queue and starts its worker thread
+INPUT:
+	@param matamazom - the warehouse, must outlive the queue
+OUTPUT:
+	the new queue, NULL if matamazom is NULL or out of memory/threads
+*/
+MtmShipQueue mtmShipQueueCreate(Matamazom matamazom);
+
+/*
+mtmShipQueueDestroy - ships the pending requests, stops the worker and
+destroys the queue. tickets of shipped requests stay valid.
+INPUT:
+	@param queue - queue to destroy, may be NULL
+*/
+void mtmShipQueueDestroy(MtmShipQueue queue);
+
+/*
+mtmShipOrderAsync - queues shipping of an order, without blocking
+INPUT:
+	@param queue - the ship queue
+	@param orderId - id of the order to ship
+	@param callback - called by the worker once the order is handled with
+	                  the result of mtmShipOrder, may be NULL
+	@param context - passed as is to callback
+	@param ticket - where a ticket of the request is returned, may be NULL.
+	                a returned ticket must be given to mtmShipTicketWait
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if queue is NULL
+	MATAMAZOM_OUT_OF_MEMORY - if allocation failed
+	MATAMAZOM_SUCCESS - if the request was queued
+*/
+MatamazomResult mtmShipOrderAsync(MtmShipQueue queue,
+                                  const unsigned int orderId,
+                                  MtmShipCallback callback, void* context,
+                                  MtmShipTicket* ticket);
+
+/*
+mtmShipTicketPoll - checks whether the request of a ticket was handled
+INPUT:
+	@param ticket - the ticket
+OUTPUT:
+	true if handled (mtmShipTicketWait wont block), else false
+*/
+bool mtmShipTicketPoll(MtmShipTicket ticket);
+
+/*
+mtmShipTicketWait - waits until the request of a ticket is handled and
+destroys the ticket
+INPUT:
+	@param ticket - the ticket
+OUTPUT:
+	MATAMAZOM_NULL_ARGUMENT - if ticket is NULL
+	else the result of mtmShipOrder for the request
+*/
+MatamazomResult mtmShipTicketWait(MtmShipTicket ticket);
+
+/*
+mtmShipQueueLock - locks the warehouse of the queue against the worker
+INPUT:
+	@param queue - the ship queue
+*/
+void mtmShipQueueLock(MtmShipQueue queue);
+
+/*
+mtmShipQueueUnlock - unlocks the warehouse of the queue
+INPUT:
+	@param queue - the ship queue
+*/
+void mtmShipQueueUnlock(MtmShipQueue queue);
+
+#endif //SHIP_QUEUE_H_
@@ -0,0 +1,558 @@
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "matamazom.h"
+#include "matamazom_stats.h"
+
+/*
+matamazom_trace - synthetic workload generator and replay harness
+
+build (from the repository root, next to the library sources):
+	gcc -std=c99 -I. *.c tools/matamazom_trace.c -o matamazom_trace -lm \
+	    -lpthread
+	(add -DMATAMAZOM_STATS for the per-API counters of matamazom_stats.h)
+
+usage:
+	matamazom_trace generate <ops> <products> <seed> <skew>
+	                [new change order line ship cancel report] > trace.txt
+	matamazom_trace replay <trace.txt>
+
+generate writes a trace of warehouse operations to stdout. the optional
+weights set the operation mix, skew is the zipf exponent used to pick
+products (0 is uniform, ~1 is a typical "few hot SKUs" catalogue).
+replay drives the trace through matamazom.h and reports throughput and
+p50/p99/p999 latency per API.
+
+trace format (one operation per line):
+	N <product id> <amount type> <amount> <price> <name>
+	C <product id> <amount>
+	O
+	L <order index> <product id> <amount>
+	S <order index>
+	X <order index>
+	P
+	B
+order index is the position of the order in the sequence of O lines, the
+replayer maps it to the id returned by mtmCreateNewOrder.
+*/
+
+#define NS_IN_SEC 1000000000.0
+#define MAX_LINE 256
+#define MAX_NAME 64
+#define DEF_MIX_NEW 5
+#define DEF_MIX_CHANGE 25
+#define DEF_MIX_ORDER 10
+#define DEF_MIX_LINE 40
+#define DEF_MIX_SHIP 10
+#define DEF_MIX_CANCEL 5
+#define DEF_MIX_REPORT 5
+#define MAX_LINE_AMOUNT 5
+#define MAX_STOCK_CHANGE 50
+#define MAX_PRICE 100
+#define INITIAL_CAPACITY 64
+#define NO_ORDER 0
+#define GENERATE_ARGS 6
+#define MIX_ARGS 7
+#define PERCENTILE_50 0.50
+#define PERCENTILE_99 0.99
+#define PERCENTILE_999 0.999
+
+//apis measured by the replayer, the order matches the report
+typedef enum TraceApi_t {
+	TRACE_NEW_PRODUCT,
+	TRACE_CHANGE_AMOUNT,
+	TRACE_CREATE_ORDER,
+	TRACE_CHANGE_IN_ORDER,
+	TRACE_SHIP_ORDER,
+	TRACE_CANCEL_ORDER,
+	TRACE_PRINT_INVENTORY,
+	TRACE_PRINT_BEST_SELLING,
+	TRACE_API_COUNT
+} TraceApi;
+
+static const char* api_names[TRACE_API_COUNT] = {
+	"mtmNewProduct",
+	"mtmChangeProductAmount",
+	"mtmCreateNewOrder",
+	"mtmChangeProductAmountInOrder",
+	"mtmShipOrder",
+	"mtmCancelOrder",
+	"mtmPrintInventory",
+	"mtmPrintBestSelling"
+};
+
+//latency samples of a single api
+typedef struct LatencySamples_t {
+	double* samples;//latencies in nanoseconds
+	int size;
+	int capacity;
+	int errors;//calls that didnt return success
+} LatencySamples;
+
+//dynamic array of unsigned ints (product ids, order ids)
+typedef struct IdArray_t {
+	unsigned int* ids;
+	int size;
+	int capacity;
+} IdArray;
+
+/*
+idArrayPush - appends an id to the array, grows it if needed
+INPUT:
+	@param array - array to append to
+	@param id - id to append
+OUTPUT:
+	true if succeeded, false if out of memory
+*/
+static bool idArrayPush(IdArray* array, unsigned int id) {
+
+	if (array->size == array->capacity) {
+		int new_capacity = (array->capacity == 0) ? INITIAL_CAPACITY :
+		                                            array->capacity * 2;
+		unsigned int* new_ids = realloc(array->ids,
+		                                new_capacity * sizeof(*new_ids));
+		if (new_ids == NULL) {
+			return false;
+		}
+		array->ids = new_ids;
+		array->capacity = new_capacity;
+	}
+	array->ids[array->size++] = id;
+	return true;
+}
+
+/*
+idArrayRemoveAt - removes the id in the given index (order isnt kept)
+INPUT:
+	@param array - array to remove from
+	@param index - index of id to remove
+*/
+static void idArrayRemoveAt(IdArray* array, int index) {
+	array->ids[index] = array->ids[--array->size];
+}
+
+/*
+randomUnit - returns a uniform random number in [0,1)
+*/
+static double randomUnit() {
+	return rand() / ((double)RAND_MAX + 1.0);
+}
+
+/*
+zipfCreate - builds the cumulative distribution of a zipf distribution
+INPUT:
+	@param size - number of ranks
+	@param skew - zipf exponent, 0 for uniform
+OUTPUT:
+	allocated cdf array of the given size, NULL if out of memory
+*/
+static double* zipfCreate(int size, double skew) {
+
+	double* cdf = malloc(size * sizeof(*cdf));
+	if (cdf == NULL) {
+		return NULL;
+	}
+	double sum = 0;
+	for (int i = 0; i < size; i++) {
+		sum += 1.0 / pow(i + 1, skew);
+		cdf[i] = sum;
+	}
+	for (int i = 0; i < size; i++) {
+		cdf[i] /= sum;
+	}
+	return cdf;
+}
+
+/*
+zipfSample - samples a rank from a zipf cdf with binary search
+INPUT:
+	@param cdf - cdf created by zipfCreate
+	@param size - number of ranks
+OUTPUT:
+	sampled rank in [0,size)
+*/
+static int zipfSample(const double* cdf, int size) {
+
+	double target = randomUnit();
+	int low = 0;
+	int high = size - 1;
+	while (low < high) {
+		int middle = (low + high) / 2;
+		if (cdf[middle] < target) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/*
+pickOperation - picks an operation according to the weights
+INPUT:
+	@param mix - weights of the operations (in trace api order, without
+	             best selling which shares the report weight)
+	@param total - sum of weights
+OUTPUT:
+	the picked operation
+*/
+static TraceApi pickOperation(const int* mix, int total) {
+
+	int target = (int)(randomUnit() * total);
+	for (int i = 0; i < TRACE_PRINT_INVENTORY; i++) {
+		if (target < mix[i]) {
+			return (TraceApi)i;
+		}
+		target -= mix[i];
+	}
+	return (randomUnit() < 0.5) ? TRACE_PRINT_INVENTORY :
+	                              TRACE_PRINT_BEST_SELLING;
+}
+
+/*
+generateTrace - writes a synthetic trace to output
+INPUT:
+	@param ops - number of operations
+	@param products - size of the catalogue
+	@param skew - zipf exponent for product popularity
+	@param mix - operation weights (see pickOperation)
+	@param output - stream to write into
+OUTPUT:
+	0 on success, 1 if out of memory
+*/
+static int generateTrace(int ops, int products, double skew, const int* mix,
+                         FILE* output) {
+
+	double* cdf = zipfCreate(products, skew);
+	IdArray open_orders = { NULL, 0, 0 };
+	if (cdf == NULL) {
+		return 1;
+	}
+	int total = 0;
+	for (int i = 0; i <= TRACE_PRINT_INVENTORY; i++) {
+		total += mix[i];
+	}
+
+	//half of the catalogue (at least one product) is loaded up front, low
+	//ids are the popular ones
+	unsigned int created_products = 0;
+	int created_orders = 0;
+	for (int i = 0; i < ops; i++) {
+		TraceApi op = (created_products < (unsigned int)(products + 1) / 2) ?
+		              TRACE_NEW_PRODUCT : pickOperation(mix, total);
+		if (op == TRACE_NEW_PRODUCT && created_products == (unsigned)products){
+			op = TRACE_CHANGE_AMOUNT;
+		}
+		if ((op == TRACE_CHANGE_IN_ORDER || op == TRACE_SHIP_ORDER ||
+		     op == TRACE_CANCEL_ORDER) && open_orders.size == 0) {
+			op = TRACE_CREATE_ORDER;
+		}
+		//only ids that were already created, so the trace has no
+		//spurious PRODUCT_NOT_EXIST errors
+		unsigned int product_id = (created_products == 0) ? 0 :
+		        (unsigned int)zipfSample(cdf, products) % created_products;
+		int order_slot = (open_orders.size == 0) ? 0 :
+		                 (int)(randomUnit() * open_orders.size);
+
+		switch (op) {
+		case TRACE_NEW_PRODUCT:
+			fprintf(output, "N %u %d %d %d product%u\n", created_products,
+			        MATAMAZOM_INTEGER_AMOUNT, rand() % MAX_STOCK_CHANGE,
+			        1 + rand() % MAX_PRICE, created_products);
+			created_products++;
+			break;
+		case TRACE_CHANGE_AMOUNT:
+			fprintf(output, "C %u %d\n", product_id,
+			        rand() % (2 * MAX_STOCK_CHANGE) - MAX_STOCK_CHANGE / 2);
+			break;
+		case TRACE_CREATE_ORDER:
+			fprintf(output, "O\n");
+			if (!idArrayPush(&open_orders, created_orders++)) {
+				free(cdf);
+				free(open_orders.ids);
+				return 1;
+			}
+			break;
+		case TRACE_CHANGE_IN_ORDER:
+			fprintf(output, "L %u %u %d\n", open_orders.ids[order_slot],
+			        product_id, 1 + rand() % MAX_LINE_AMOUNT);
+			break;
+		case TRACE_SHIP_ORDER:
+		case TRACE_CANCEL_ORDER:
+			fprintf(output, "%c %u\n", (op == TRACE_SHIP_ORDER) ? 'S' : 'X',
+			        open_orders.ids[order_slot]);
+			idArrayRemoveAt(&open_orders, order_slot);
+			break;
+		case TRACE_PRINT_INVENTORY:
+			fprintf(output, "P\n");
+			break;
+		default:
+			fprintf(output, "B\n");
+			break;
+		}
+	}
+
+	free(cdf);
+	free(open_orders.ids);
+	return 0;
+}
+
+//custom data of replayed products - the price of a single unit
+static MtmProductData copyPrice(MtmProductData data) {
+	double* copy = malloc(sizeof(*copy));
+	if (copy != NULL) {
+		*copy = *(double*)data;
+	}
+	return copy;
+}
+
+static void freePrice(MtmProductData data) {
+	free(data);
+}
+
+static double getPrice(MtmProductData data, const double amount) {
+	return *(double*)data * amount;
+}
+
+/*
+nowNanoseconds - returns monotonic time in nanoseconds
+*/
+static double nowNanoseconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * NS_IN_SEC + now.tv_nsec;
+}
+
+/*
+recordLatency - adds a sample to the api samples
+INPUT:
+	@param samples - samples of the api
+	@param latency - latency of the call in nanoseconds
+	@param success - whether the call returned success
+OUTPUT:
+	true if succeeded, false if out of memory
+*/
+static bool recordLatency(LatencySamples* samples, double latency,
+                          bool success) {
+
+	if (samples->size == samples->capacity) {
+		int new_capacity = (samples->capacity == 0) ? INITIAL_CAPACITY :
+		                                              samples->capacity * 2;
+		double* new_samples = realloc(samples->samples,
+		                              new_capacity * sizeof(*new_samples));
+		if (new_samples == NULL) {
+			return false;
+		}
+		samples->samples = new_samples;
+		samples->capacity = new_capacity;
+	}
+	samples->samples[samples->size++] = latency;
+	if (!success) {
+		samples->errors++;
+	}
+	return true;
+}
+
+static int compareDoubles(const void* first, const void* second) {
+	double a = *(const double*)first;
+	double b = *(const double*)second;
+	return (a > b) - (a < b);
+}
+
+/*
+percentile - returns the given percentile of sorted samples
+*/
+static double percentile(const LatencySamples* samples, double fraction) {
+	int index = (int)(fraction * (samples->size - 1));
+	return samples->samples[index];
+}
+
+/*
+printReport - prints throughput and latency percentiles per api
+INPUT:
+	@param samples - samples of every api (sorted in place)
+	@param total_ns - wall time of the replay
+	@param output - stream to print into
+*/
+static void printReport(LatencySamples* samples, double total_ns,
+                        FILE* output) {
+
+	int total_calls = 0;
+	fprintf(output, "%-30s %10s %8s %12s %12s %12s\n", "api", "calls",
+	        "errors", "p50(ns)", "p99(ns)", "p999(ns)");
+	for (int i = 0; i < TRACE_API_COUNT; i++) {
+		if (samples[i].size == 0) {
+			continue;
+		}
+		qsort(samples[i].samples, samples[i].size, sizeof(double),
+		      compareDoubles);
+		fprintf(output, "%-30s %10d %8d %12.0f %12.0f %12.0f\n",
+		        api_names[i], samples[i].size, samples[i].errors,
+		        percentile(&samples[i], PERCENTILE_50),
+		        percentile(&samples[i], PERCENTILE_99),
+		        percentile(&samples[i], PERCENTILE_999));
+		total_calls += samples[i].size;
+	}
+	fprintf(output, "total: %d calls in %.3f s, %.0f ops/s\n", total_calls,
+	        total_ns / NS_IN_SEC, total_calls / (total_ns / NS_IN_SEC));
+}
+
+/*
+replayOperation - runs a single trace line against the warehouse
+INPUT:
+	@param matamazom - warehouse to drive
+	@param line - trace line
+	@param orders - order index to order id mapping
+	@param sink - stream reports are printed into
+	@param api - the api that was called
+OUTPUT:
+	result of the call
+*/
+static MatamazomResult replayOperation(Matamazom matamazom, const char* line,
+                                       IdArray* orders, FILE* sink,
+                                       TraceApi* api) {
+
+	unsigned int id = 0;
+	unsigned int index = 0;
+	int type = 0;
+	double amount = 0;
+	double price = 0;
+	char name[MAX_NAME] = "";
+
+	switch (line[0]) {
+	case 'N':
+		sscanf(line + 1, "%u %d %lf %lf %63s", &id, &type, &amount, &price,
+		       name);
+		*api = TRACE_NEW_PRODUCT;
+		return mtmNewProduct(matamazom, id, name, amount,
+		                     (MatamazomAmountType)type, &price, copyPrice,
+		                     freePrice, getPrice);
+	case 'C':
+		sscanf(line + 1, "%u %lf", &id, &amount);
+		*api = TRACE_CHANGE_AMOUNT;
+		return mtmChangeProductAmount(matamazom, id, amount);
+	case 'O':
+		*api = TRACE_CREATE_ORDER;
+		id = mtmCreateNewOrder(matamazom);
+		if (!idArrayPush(orders, id)) {
+			return MATAMAZOM_OUT_OF_MEMORY;
+		}
+		return (id == NO_ORDER) ? MATAMAZOM_OUT_OF_MEMORY : MATAMAZOM_SUCCESS;
+	case 'L':
+		sscanf(line + 1, "%u %u %lf", &index, &id, &amount);
+		*api = TRACE_CHANGE_IN_ORDER;
+		return mtmChangeProductAmountInOrder(matamazom,
+		                   (index < (unsigned)orders->size) ?
+		                   orders->ids[index] : NO_ORDER, id, amount);
+	case 'S':
+	case 'X':
+		sscanf(line + 1, "%u", &index);
+		id = (index < (unsigned)orders->size) ? orders->ids[index] : NO_ORDER;
+		*api = (line[0] == 'S') ? TRACE_SHIP_ORDER : TRACE_CANCEL_ORDER;
+		return (line[0] == 'S') ? mtmShipOrder(matamazom, id) :
+		                          mtmCancelOrder(matamazom, id);
+	case 'P':
+		*api = TRACE_PRINT_INVENTORY;
+		return mtmPrintInventory(matamazom, sink);
+	default:
+		*api = TRACE_PRINT_BEST_SELLING;
+		return mtmPrintBestSelling(matamazom, sink);
+	}
+}
+
+/*
+replayTrace - replays a trace file and prints the report to stdout
+INPUT:
+	@param input - trace stream
+OUTPUT:
+	0 on success, 1 on failure
+*/
+static int replayTrace(FILE* input) {
+
+	Matamazom matamazom = matamazomCreate();
+	FILE* sink = fopen("/dev/null", "w");
+	LatencySamples samples[TRACE_API_COUNT];
+	IdArray orders = { NULL, 0, 0 };
+	memset(samples, 0, sizeof(samples));
+	if (matamazom == NULL || sink == NULL) {
+		matamazomDestroy(matamazom);
+		if (sink != NULL) {
+			fclose(sink);
+		}
+		return 1;
+	}
+
+	int ret_value = 0;
+	char line[MAX_LINE];
+	double replay_start = nowNanoseconds();
+	while (fgets(line, sizeof(line), input) != NULL) {
+		if (line[0] == '\n' || line[0] == '#') {
+			continue;
+		}
+		TraceApi api = TRACE_PRINT_BEST_SELLING;
+		double start = nowNanoseconds();
+		MatamazomResult result = replayOperation(matamazom, line, &orders,
+		                                         sink, &api);
+		double latency = nowNanoseconds() - start;
+		if (!recordLatency(&samples[api], latency,
+		                   result == MATAMAZOM_SUCCESS)) {
+			ret_value = 1;
+			break;
+		}
+	}
+	double total = nowNanoseconds() - replay_start;
+
+	if (ret_value == 0) {
+		printReport(samples, total, stdout);
+#ifdef MATAMAZOM_STATS
+		mtmDumpStats(matamazom, stdout);
+#endif
+	}
+	for (int i = 0; i < TRACE_API_COUNT; i++) {
+		free(samples[i].samples);
+	}
+	free(orders.ids);
+	fclose(sink);
+	matamazomDestroy(matamazom);
+	return ret_value;
+}
+
+int main(int argc, char** argv) {
+
+	if (argc >= GENERATE_ARGS && strcmp(argv[1], "generate") == 0) {
+		int mix[MIX_ARGS] = { DEF_MIX_NEW, DEF_MIX_CHANGE, DEF_MIX_ORDER,
+		                      DEF_MIX_LINE, DEF_MIX_SHIP, DEF_MIX_CANCEL,
+		                      DEF_MIX_REPORT };
+		for (int i = 0; i < MIX_ARGS && GENERATE_ARGS + i < argc; i++) {
+			mix[i] = atoi(argv[GENERATE_ARGS + i]);
+		}
+		int products = atoi(argv[3]);
+		srand((unsigned int)atoi(argv[4]));
+		if (products <= 0) {
+			fprintf(stderr, "products must be positive\n");
+			return 1;
+		}
+		return generateTrace(atoi(argv[2]), products, atof(argv[5]), mix,
+		                     stdout);
+	}
+
+	if (argc == 3 && strcmp(argv[1], "replay") == 0) {
+		FILE* input = fopen(argv[2], "r");
+		if (input == NULL) {
+			fprintf(stderr, "cannot open %s\n", argv[2]);
+			return 1;
+		}
+		int ret_value = replayTrace(input);
+		fclose(input);
+		return ret_value;
+	}
+
+	fprintf(stderr, "usage: %s generate <ops> <products> <seed> <skew> "
+	        "[new change order line ship cancel report]\n"
+	        "       %s replay <trace>\n", argv[0], argv[0]);
+	return 1;
+}